@@ -0,0 +1,45 @@
+/*=====================================================
+ * Acceptance.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file defines the integer thresholds
+ * that replace u ~ U(0, 1) < prob in accept-reject
+ * processes by a compare of a raw 32-bit random number
+ *=====================================================*/
+
+
+#ifndef ACCEPTANCE_H_
+#define ACCEPTANCE_H_
+
+
+#include <math.h>
+#include <stdint.h>
+
+
+namespace wenchong
+{
+
+/*
+ * threshold t of an acceptance probability prob,
+ * a move is accepted if r <= t for r uniform in
+ * [0, 2^32), so it is accepted with
+ * (t + 1) / 2^32 = ceil(prob * 2^32) / 2^32,
+ * and always accepted if prob >= 1
+ */
+inline uint32_t acceptThreshold(double prob)
+{
+	if (prob >= 1.0)
+		return 0xFFFFFFFFu;
+
+	double t = ceil(prob * 4294967296.0) - 1.0;
+
+	return (t <= 0.0) ? 0 : (uint32_t)t;
+}
+
+};
+
+
+#endif
@@ -0,0 +1,224 @@
+/*=====================================================
+ * Autocorrelation.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class
+ * Autocorrelation, a value costs O(max lag) and
+ * Rho(t), Tau(t) are known after every value
+ *=====================================================*/
+
+
+#include "Autocorrelation.h"
+
+
+namespace wenchong
+{
+
+/*
+ * an empty estimator of the lags 1, ..., maxLag
+ */
+Autocorrelation::Autocorrelation(int maxLag) :
+	MaxLag(maxLag),
+	Ring(maxLag, 0.0),
+	First(maxLag, 0.0),
+	Lag(maxLag + 1, 0.0)
+{
+	clear();
+}
+
+
+/*
+ * forget all values
+ */
+void Autocorrelation::clear(void)
+{
+	N = 0;
+	Mean = 0.0;
+	M2 = 0.0;
+	Reference = 0.0;
+	SumY = 0.0;
+	Head = 0;
+
+	for (int t = 0; t <= MaxLag; t++)
+		Lag[t] = 0.0;
+}
+
+
+/*
+ * add the next value x of the series
+ */
+void Autocorrelation::add(double x)
+{
+	// Welford: mean and squared deviations
+	N++;
+	double delta = x - Mean;
+	Mean += delta / (double)N;
+	M2 += delta * (x - Mean);
+
+	// y is Y(i + t) of the value t back in the ring
+	if (N == 1)
+		Reference = x;
+
+	double y = x - Reference;
+	long lags = (N - 1 < MaxLag) ? N - 1 : MaxLag;
+
+	for (int t = 1; t <= lags; t++)
+		Lag[t] += Ring[slot(t)] * y;
+
+	SumY += y;
+	if (N <= MaxLag)
+		First[N - 1] = y;
+
+	if (MaxLag > 0)
+	{
+		Ring[Head] = y;
+		Head = (Head + 1 == MaxLag) ? 0 : Head + 1;
+	}
+}
+
+
+/*
+ * slot of the ring of the value t back, 1 <= t <= MaxLag
+ */
+int Autocorrelation::slot(int t)
+{
+	int s = Head - t;
+
+	return (s < 0) ? s + MaxLag : s;
+}
+
+
+/*
+ * # of values added
+ */
+long Autocorrelation::count(void)
+{
+	return N;
+}
+
+
+/*
+ * mean of the values
+ */
+double Autocorrelation::mean(void)
+{
+	return Mean;
+}
+
+
+/*
+ * variance of the values, normalized by N
+ */
+double Autocorrelation::variance(void)
+{
+	return (N > 0) ? M2 / (double)N : 0.0;
+}
+
+
+/*
+ * Rho(t) = R(t) / sigma^2 with the autocovariance
+ * R(t) = E[(X(i) - u)(X(i+t) - u)] over the N - t pairs,
+ * from the sums of Y and the Y(i) of the pairs, which
+ * are all but the last t, the Y(i+t) all but the first
+ * t, 0 without pairs
+ */
+double Autocorrelation::rho(int t)
+{
+	if (t == 0)
+		return 1.0;
+
+	if (N - t <= 0)
+		return 0.0;
+
+	double lower = SumY;
+	double upper = SumY;
+
+	for (int s = 1; s <= t; s++)
+	{
+		lower -= Ring[slot(s)];
+		upper -= First[s - 1];
+	}
+
+	double u = SumY / (double)N;
+	double Rt = (Lag[t] - u * (lower + upper)) / (double)(N - t) + u * u;
+
+	return Rt / variance();
+}
+
+
+/*
+ * Tau(t) = 1/2 + sum of Rho(1), ..., Rho(t)
+ */
+double Autocorrelation::tau(int t)
+{
+	double Tau = 0.5;
+
+	for (int s = 1; s <= t; s++)
+		Tau += rho(s);
+
+	return Tau;
+}
+
+
+/*
+ * # of doubles of the state
+ */
+int Autocorrelation::stateSize(void)
+{
+	return 6 + MaxLag + MaxLag + (MaxLag + 1);
+}
+
+
+/*
+ * the state: N, Mean, M2, Head, Reference, SumY, the
+ * ring, the first values, the sums
+ */
+void Autocorrelation::saveState(double* state)
+{
+	state[0] = (double)N;
+	state[1] = Mean;
+	state[2] = M2;
+	state[3] = (double)Head;
+	state[4] = Reference;
+	state[5] = SumY;
+
+	for (int j = 0; j < MaxLag; j++)
+	{
+		state[6 + j] = Ring[j];
+		state[6 + MaxLag + j] = First[j];
+	}
+
+	for (int t = 0; t <= MaxLag; t++)
+		state[6 + 2 * MaxLag + t] = Lag[t];
+}
+
+
+/*
+ * restore a state of saveState()
+ */
+void Autocorrelation::loadState(const double* state)
+{
+	N = (long)state[0];
+	Mean = state[1];
+	M2 = state[2];
+	Head = (int)state[3];
+	Reference = state[4];
+	SumY = state[5];
+
+	for (int j = 0; j < MaxLag; j++)
+	{
+		Ring[j] = state[6 + j];
+		First[j] = state[6 + MaxLag + j];
+	}
+
+	for (int t = 0; t <= MaxLag; t++)
+		Lag[t] = state[6 + 2 * MaxLag + t];
+}
+
+};
+
+
+/*================ End of File ================*/
@@ -0,0 +1,69 @@
+/*=====================================================
+ * Autocorrelation.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the class Autocorrelation
+ * that estimates Rho(t) and Tau(t) of a time series
+ * online, with memory of O(max lag)
+ *=====================================================*/
+
+
+#ifndef AUTOCORRELATION_H_
+#define AUTOCORRELATION_H_
+
+
+#include <vector>
+
+
+namespace wenchong
+{
+
+/*
+ * keeps Y = X - X(0), the first and the last maxLag
+ * values of Y and the sums of Y(i) * Y(i + t) for
+ * t = 1, ..., maxLag, from which the autocovariance
+ * about the mean follows without the cancellation of
+ * E[X(i)X(i+t)] - u^2, the mean and the variance are
+ * updated by Welford's method
+ */
+class Autocorrelation
+{
+public:
+	Autocorrelation(int maxLag);
+
+	void clear(void);
+	void add(double x);
+
+	long count(void);
+	double mean(void);
+	double variance(void);
+	double rho(int t);
+	double tau(int t);
+
+	// the state as doubles, for checkpoints
+	int stateSize(void);
+	void saveState(double* state);
+	void loadState(const double* state);
+
+private:
+	int slot(int t);
+
+	int MaxLag;               // largest lag t
+	long N;                   // # of values added
+	double Mean;              // running mean
+	double M2;                // sum of squared deviations
+	double Reference;         // X(0)
+	double SumY;              // sum of Y
+	std::vector<double> Ring; // the last MaxLag values of Y
+	int Head;                 // slot of the next value
+	std::vector<double> First; // the first MaxLag values of Y
+	std::vector<double> Lag;  // sums of Y(i) * Y(i + t)
+};
+
+};
+
+
+#endif
@@ -21,12 +21,14 @@ namespace wenchong
  */
 BaseLattice::BaseLattice(Machine* host, int init, double beta, unsigned int seed) :
 	Generator(seed),
-	UniformDist(0.0, 1.0)
+	UniformDist(0.0, 1.0),
+	Acf(DELTA_TIME)
 {
 	if (init != 1 && init != -1)
 		throw std::invalid_argument("BaseLattice::(): invalid initial spin");
 
-	Comms = new Communicator();
+	Host = host;
+	Comms = new Communicator(host);
 	
 	Spins = new Field(host);
 	Spins->init(init);
@@ -35,11 +37,75 @@ BaseLattice::BaseLattice(Machine* host, int init, double beta, unsigned int seed
 	nRow = Spins->nxLocal;
 	nCol = Spins->nyLocal;
 
+	// running totals, kept up to date by the flips
+	Magnet = Spins->sumData();
+	Energy = -Spins->sumBonds();
+
 	Beta = beta;
 	Measures = host->Measures;
 	nSweeps = host->nSweeps;
 	Mean = 0.0;
 	Var = 0.0;
+	Suffix = "";
+
+	Ckp = (host->CheckpointInterval > 0) ? new Checkpoint(host, Spins, Comms) : NULL;
+	Thrown = 0;
+	Swept = 0;
+	Stopped = false;
+
+	Snap = (host->SnapshotInterval > 0) ? new Snapshot(host, Spins) : NULL;
+	XtMap = NULL;
+	XtView = NULL;
+	nXtView = 0;
+	XtStride = 1;
+}
+
+
+/*
+ * construct the BaseLattice system without a Field,
+ * the subclass allocates its own spin storage and
+ * sets Size, nRow and nCol
+ */
+BaseLattice::BaseLattice(Machine* host, double beta, unsigned int seed) :
+	Generator(seed),
+	UniformDist(0.0, 1.0),
+	Acf(DELTA_TIME)
+{
+	Host = host;
+	Comms = new Communicator(host);
+	Spins = NULL;
+
+	Magnet = 0;
+	Energy = 0;
+
+	Size = 0;
+	nRow = 0;
+	nCol = 0;
+
+	Beta = beta;
+	Measures = host->Measures;
+	nSweeps = host->nSweeps;
+	Mean = 0.0;
+	Var = 0.0;
+	Suffix = "";
+
+	// checkpoints and snapshots hold the spins of a Field
+	if (host->CheckpointInterval > 0 || host->SnapshotInterval > 0)
+	{
+		std::cout << "checkpoint=... and snapshot=... need algo=metrop, "
+				  << "heatbath, swendsenwang or wolff\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	Ckp = NULL;
+	Thrown = 0;
+	Swept = 0;
+	Stopped = false;
+	Snap = NULL;
+	XtMap = NULL;
+	XtView = NULL;
+	nXtView = 0;
+	XtStride = 1;
 }
 
 
@@ -48,6 +114,9 @@ BaseLattice::BaseLattice(Machine* host, int init, double beta, unsigned int seed
  */
 BaseLattice::~BaseLattice()
 {
+	delete XtMap;
+	delete Snap;
+	delete Ckp;
 	delete Comms;
 	delete Spins;
 }
@@ -61,75 +130,544 @@ void BaseLattice::flipSpin(int row, int col)
 	if (row >= nRow || row < 0 || col >= nCol || col < 0)
 		throw std::out_of_range("BaseLattice::(): row and col our of bounds");
 
+	int current = (*Spins)(row, col);
+	int neighbours = (*Spins)(row, col - 1) + (*Spins)(row, col + 1)
+				   + (*Spins)(row - 1, col) + (*Spins)(row + 1, col);
+
+	Magnet -= 2 * current;
+	Energy += 2 * current * neighbours;
+
 	(*Spins)(row, col) *= -1;
 }
 
 
 /*
- * sum up all values of spin in the lattice
+ * sum up all values of spin in the lattice,
+ * the running total of the flips
  */
-int BaseLattice::sumSpins(void)
+long BaseLattice::sumSpins(void)
 {
-	return Spins->sumData();
+	return Magnet;
 }
 
 
 /*
- * load X from file to Xt vector
+ * bond energy -sum(si * sj) of the lattice,
+ * the running total of the flips
  */
-void BaseLattice::retrieveXt(const char* filenameXt)
+long BaseLattice::bondEnergy(void)
 {
-	// only get data from file inside one process
-	if (Spins->Host->Rank == ROOT)
+	return Energy;
+}
+
+
+/*
+ * the local value of a measure that is summed up over
+ * the processes for X, the sum of the spins
+ */
+double BaseLattice::spinMeasure(void)
+{
+	return (double)sumSpins();
+}
+
+
+/*
+ * X of a measure from the global sum of spinMeasure(),
+ * the square of the magnetization
+ */
+double BaseLattice::computeX(double spinSum, double nGlobalSites)
+{
+	// computing magnetization
+	double average = spinSum / nGlobalSites;
+
+	// computing X = magnetization ^ 2
+	return average * average;
+}
+
+
+/*
+ * start the measures of point # point of a scan:
+ * clear Rho, Tau, Mean and Var and write the output of the
+ * point to xt.point.bin, et.point.bin, ...
+ */
+void BaseLattice::startPoint(int point)
+{
+	std::stringstream suffix;
+	suffix << "." << point;
+	Suffix = suffix.str();
+
+	Acf.clear();
+	Mean = 0.0;
+	Var = 0.0;
+}
+
+
+/*
+ * name of an output file: name.bin, or name.k.bin
+ * for point # k of a scan, for extension ".bin"
+ */
+std::string BaseLattice::outputName(const char* name, const char* extension)
+{
+	return std::string(name) + Suffix + extension;
+}
+
+
+/*
+ * the header of the time series name of this run,
+ * nColumns values per measure
+ */
+SeriesHeader BaseLattice::seriesHeader(const char* name, int nColumns)
+{
+	return TimeSeries::makeHeader(name, Host->getOption("algo", "metrop"),
+								  atoi(Host->Argv[1]), atoi(Host->Argv[2]),
+								  nColumns, nSweeps, Host->Seed, Beta);
+}
+
+
+/*
+ * the Philox counter of the algorithm, which with the
+ * spins and the global seed gives its random numbers,
+ * none by default
+ */
+unsigned int BaseLattice::getCounter(void)
+{
+	return 0;
+}
+
+
+/*
+ * restore the Philox counter of the algorithm
+ */
+void BaseLattice::setCounter(unsigned int /*counter*/)
+{
+}
+
+
+/*
+ * thermalize by numSweeps sweeps, with checkpoint=N
+ * in steps of nSweeps sweeps from the last checkpoint,
+ * a checkpoint every N steps
+ */
+void BaseLattice::thermalize(int numSweeps)
+{
+	if (Ckp == NULL)
 	{
-		int count = -1;
-		double average = 0.0; // average spin in a sweep at time(meas) t
-		std::ifstream ifsXt;
+		update(numSweeps);
+		return;
+	}
 
-		ifsXt.open(filenameXt, std::ifstream::in);
+	restoreCheckpoint();
 
-		if (!ifsXt.is_open())
-			throw std::invalid_argument("BaseLattice::(): Error opening file xt.dat!");
-	
-		// load X from file to Xt vector,
-		// compute Mean and Var
-		while (!ifsXt.eof())
+	int step = std::max(nSweeps, 1);
+
+	while (Thrown < numSweeps && !Stopped)
+	{
+		int n = (int)std::min((long)step, numSweeps - Thrown);
+
+		update(n);
+		Thrown += n;
+
+		if (Ckp->isDue((Thrown + step - 1) / step))
+			saveCheckpoint();
+	}
+}
+
+
+/*
+ * whether the run stopped at a checkpoint before
+ * all measures are done, on SIGTERM or wall time
+ */
+bool BaseLattice::isStopped(void)
+{
+	return Stopped;
+}
+
+
+/*
+ * write a checkpoint of the run so far, the
+ * measures are on ROOT
+ */
+void BaseLattice::saveCheckpoint(void)
+{
+	CheckpointHeader header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.Magic, "ISINGCK2", 8);
+	strncpy(header.Algo, Host->getOption("algo", "metrop"), sizeof(header.Algo) - 1);
+	header.nxGlobal = Spins->nxGlobal;
+	header.nyGlobal = Spins->nyGlobal;
+	header.nProc = Host->nProc;
+	header.nSweeps = nSweeps;
+	header.Seed = Host->Seed;
+	header.Counter = getCounter();
+	header.Thrown = Thrown;
+	header.Swept = Swept;
+	header.Measured = Acf.count();
+	header.nState = Acf.stateSize();
+	header.Beta = Beta;
+
+	// the estimator of Rho and Tau instead of the series,
+	// which is in the time series files
+	std::vector<double> state(Acf.stateSize());
+	Acf.saveState(state.data());
+
+	Ckp->write(header, Generator, state);
+	Stopped = Ckp->isStopping();
+
+	if (Stopped && Host->Rank == ROOT)
+		std::cout << "P" << Host->Rank << ": Stopped at checkpoint "
+				  << Host->CheckpointFile << "\n";
+}
+
+
+/*
+ * resume from the last checkpoint if there is one,
+ * it must be of the same algorithm, seed, beta and
+ * nSweeps, but may have any decomposition
+ */
+bool BaseLattice::restoreCheckpoint(void)
+{
+	CheckpointHeader header;
+	std::vector<double> state;
+
+	if (!Ckp->read(header, Generator, state))
+		return false;
+
+	if (strncmp(header.Algo, Host->getOption("algo", "metrop"), sizeof(header.Algo)) != 0 ||
+		header.Seed != Host->Seed || header.Beta != Beta ||
+		header.nSweeps != nSweeps || header.Measured > Measures ||
+		header.nState != Acf.stateSize())
+	{
+		if (Host->Rank == ROOT)
+			std::cout << Host->CheckpointFile << " is a checkpoint of another run\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	setCounter(header.Counter);
+	Thrown = header.Thrown;
+	Swept = header.Swept;
+
+	Acf.loadState(state.data());
+
+	// the ghost cells and the running totals
+	// of the spins read
+	if (Spins->nGhost > 1)
+	{
+		Comms->sendBoundaryBands(Spins);
+	}
+	else
+	{
+		Comms->sendBoundaryData(Spins, EVEN);
+		Comms->sendBoundaryData(Spins, ODD);
+	}
+
+	Magnet = Spins->sumData();
+	Energy = -Spins->sumBonds();
+
+	if (Host->Rank == ROOT)
+		std::cout << "P" << Host->Rank << ": Resumed from " << Host->CheckpointFile
+				  << " after " << Thrown << " thermalization sweeps and "
+				  << header.Measured << " measures\n";
+
+	return true;
+}
+
+
+/*
+ * write the spins after measure # measure to
+ * snap.measure.bin, or snap.k.measure.bin at point k
+ * of a scan
+ */
+void BaseLattice::writeSnapshot(int measure)
+{
+	std::stringstream filename;
+	filename << "snap" << Suffix << "." << measure << ".bin";
+
+	Snap->write(filename.str());
+}
+
+
+/*
+ * the local values of a measure: sums[0] of
+ * spinMeasure() and sums[1] of the bond energy,
+ * for drivers that reduce the measures themselves
+ */
+void BaseLattice::measureLocal(double* sums)
+{
+	sums[0] = spinMeasure();
+	sums[1] = (double)bondEnergy();
+}
+
+
+/*
+ * compute susceptibility X=<m^2>,
+ * the local sums of the measures are kept and reduced
+ * to ROOT Batch measures at a time, so Rho, Tau, Mean
+ * and Var are on ROOT only, or with InFlight > 0 reduced
+ * to all processes by non-blocking reductions that
+ * complete InFlight measures later,
+ * with checkpoint=N the measures go on from the last
+ * checkpoint, and are written to it every N measures
+ */
+void BaseLattice::computeXt(void)
+{
+	int max = Measures * nSweeps;  // number of total sweeps
+	TimeSeries seriesXt;
+	TimeSeries seriesEt;
+
+	if (Stopped)
+		return;
+
+	// only write output to file inside one process
+	if (Host->Rank == ROOT)
+	{
+		// after the measures of the checkpoint resumed from
+		seriesXt.open(outputName("xt", ".bin"), seriesHeader("xt", 1), Acf.count());
+		seriesEt.open(outputName("et", ".bin"), seriesHeader("et", 1), Acf.count());
+	}
+
+	// local sums of spins and bonds of the measures
+	// not reduced yet, two values per measure
+	std::vector<double> localSums;
+	localSums.reserve(2 * std::min(Host->Batch, Measures));
+
+	// with InFlight > 0, a ring of the measures whose
+	// global sums are in flight, the oldest at head
+	int nRing = Host->InFlight;
+	std::vector<double> ringLocal(2 * nRing), ringGlobal(2 * nRing);
+	std::vector<MPI_Request> ringRequest(nRing);
+	int head = 0, nPending = 0;
+
+	// comuting X=<m^2>
+	for (int i = (int)Swept; i < max; i++)
+	{
+		update(1);
+		
+		// sum up the spins at time t at every nSweeps
+		if ((i % nSweeps) != 0)
+			continue;
+
+		if (nRing == 0)
 		{
-			count++;
+			localSums.push_back(spinMeasure());
+			localSums.push_back((double)bondEnergy());
 
-			// computing X = magnetization ^ 2
-			ifsXt >> average;
+			if ((int)localSums.size() == 2 * Host->Batch)
+				reduceMeasures(localSums, seriesXt, seriesEt);
+		}
+		else
+		{
+			// complete the oldest sum if the ring is full,
+			// the others keep going while sweeping
+			if (nPending == nRing)
+			{
+				Comms->waitGlobalSum(&ringRequest[head]);
+				storeMeasure(ringGlobal[2 * head], ringGlobal[2 * head + 1], seriesXt, seriesEt);
 
-			// store X for Rho and Tau evaluation
-			Xt.push_back(average);
+				head = (head + 1) % nRing;
+				nPending--;
+			}
 
-			// calculate Mean and Variance of X
-			Mean += average;
-			Var += average * average;
+			int slot = (head + nPending) % nRing;
+			ringLocal[2 * slot] = spinMeasure();
+			ringLocal[2 * slot + 1] = (double)bondEnergy();
+
+			Comms->startGlobalSum(&ringLocal[2 * slot], &ringGlobal[2 * slot], 2,
+								  &ringRequest[slot]);
+			nPending++;
 		}
-		
-		// check if the number of data in the file
-		// is equal to the number of measurements
-		if (count != Measures)
+
+		if (Snap != NULL && (i / nSweeps + 1) % Host->SnapshotInterval == 0)
+			writeSnapshot(i / nSweeps + 1);
+
+		if (Ckp == NULL || !Ckp->isDue(i / nSweeps + 1))
+			continue;
+
+		// a checkpoint holds all measures so far
+		reduceMeasures(localSums, seriesXt, seriesEt);
+
+		for (; nPending > 0; nPending--)
 		{
-			throw std::invalid_argument("BaseLattice::(): data size not match");
-			MPI_Abort(MPI_COMM_WORLD, 1);
+			Comms->waitGlobalSum(&ringRequest[head]);
+			storeMeasure(ringGlobal[2 * head], ringGlobal[2 * head + 1], seriesXt, seriesEt);
+
+			head = (head + 1) % nRing;
 		}
+
+		seriesXt.flush();
+		seriesEt.flush();
+
+		Swept = i + 1;
+		saveCheckpoint();
+
+		if (Stopped)
+			break;
+	}
+
+	reduceMeasures(localSums, seriesXt, seriesEt);
+
+	// complete the sums in flight in order
+	for (; nPending > 0; nPending--)
+	{
+		Comms->waitGlobalSum(&ringRequest[head]);
+		storeMeasure(ringGlobal[2 * head], ringGlobal[2 * head + 1], seriesXt, seriesEt);
+
+		head = (head + 1) % nRing;
+	}
 	
-		ifsXt.close();
-	
-		Mean /= (double)Measures;
-		Var = Var / (double)Measures - Mean * Mean;
+	// the last checkpoint is of the whole run, which
+	// resumes to the same results
+	if (Ckp != NULL && !Stopped)
+	{
+		seriesXt.flush();
+		seriesEt.flush();
+
+		Swept = max;
+		saveCheckpoint();
+	}
+
+	if (Host->Rank == ROOT)
+	{
+		seriesXt.close();
+		seriesEt.close();
+	}
+
+	if (Stopped)
+		return;
+
+	if (Host->Rank == ROOT || nRing > 0)
+	{
+		Mean = Acf.mean();
+		Var = Acf.variance();
 	}
 }
 
 
 /*
- * DO NOT call this method before computeXt() is called
+ * reduce the local sums of a batch of measures to ROOT,
+ * and store X and the energy per site there
+ */
+void BaseLattice::reduceMeasures(std::vector<double>& localSums,
+								 TimeSeries& seriesXt, TimeSeries& seriesEt)
+{
+	int count = (int)localSums.size();
+
+	if (count == 0)
+		return;
+
+	std::vector<double> globalSums(count, 0.0);
+
+	// get global sums over spins and bonds
+	Comms->reduceToRoot(localSums.data(), globalSums.data(), count);
+	localSums.clear();
+
+	if (Host->Rank != ROOT)
+		return;
+
+	for (int j = 0; j < count; j += 2)
+		storeMeasure(globalSums[j], globalSums[j + 1], seriesXt, seriesEt);
+}
+
+
+/*
+ * store X and the energy per site of a measure from
+ * the global sums of the spins and the bonds,
+ * only ROOT writes the files
+ */
+void BaseLattice::storeMeasure(double spinSum, double bondSum,
+							   TimeSeries& seriesXt, TimeSeries& seriesEt)
+{
+	// number of total sites of the global lattice
+	double nGlobalSites = (double)Size * (double)Host->nProc;
+
+	double average = computeX(spinSum, nGlobalSites);
+
+	// X for Rho and Tau evaluation
+	addMeasure(average);
+
+	// store X in file
+	if (Host->Rank == ROOT)
+	{
+		seriesXt.append(average);
+		seriesEt.append(bondSum / nGlobalSites);
+	}
+}
+
+
+/*
+ * add X of a measure to the estimator of Rho and Tau,
+ * with report=N ROOT prints Tau every N measures
+ */
+void BaseLattice::addMeasure(double average)
+{
+	Acf.add(average);
+
+	if (Host->Rank == ROOT && Host->ReportInterval > 0 &&
+		Acf.count() % Host->ReportInterval == 0 && Acf.count() > DELTA_TIME)
+	{
+		std::cout << "P" << Host->Rank << ": " << Acf.count() << " measures: X = "
+				  << Acf.mean() << ", Tau(" << DELTA_TIME << ") = "
+				  << Acf.tau(DELTA_TIME) << "\n";
+	}
+}
+
+
+/*
+ * map the binary series filenameXt, e.g. xt.bin, and
+ * take X as count values from value # first on, every
+ * stride-th, in place, count <= 0 takes all of them,
+ * Mean and Var are reduced by the threads
+ */
+void BaseLattice::retrieveXt(const char* filenameXt, long first, long count, long stride)
+{
+	// only get data from file inside one process
+	if (Host->Rank != ROOT)
+		return;
+
+	delete XtMap;
+	XtMap = new SeriesMap(filenameXt);
+
+	if (XtMap->Header.nColumns != 1)
+		throw std::invalid_argument("BaseLattice::(): not a series of one column");
+
+	long available = (first >= 0 && stride >= 1 && first < XtMap->nRows)
+				   ? (XtMap->nRows - first + stride - 1) / stride : 0;
+
+	if (count <= 0)
+		count = available;
+
+	if (count < 2 || count > available)
+		throw std::invalid_argument("BaseLattice::(): data size not match");
+
+	XtView = XtMap->Values + first;
+	nXtView = count;
+	XtStride = stride;
+
+	double sum = 0.0, squares = 0.0;
+
+	#pragma omp parallel for schedule(static) reduction(+:sum, squares)
+	for (long i = 0; i < count; i++)
+	{
+		double average = XtView[i * stride];
+
+		sum += average;
+		squares += average * average;
+	}
+
+	Mean = sum / (double)count;
+	Var = squares / (double)count - Mean * Mean;
+}
+
+
+/*
+ * DO NOT call this method before computeXt() or
+ * retrieveXt() is called,
+ * Rho(t) comes from the online estimator of the
+ * measures, or from the lags of the view of retrieveXt()
  */
 void BaseLattice::computeRhoTau(void)
 {
-	if (Spins->Host->Rank == ROOT)
+	if (Host->Rank == ROOT)
 	{
 		if (Mean == 0.0 || Var == 0.0)
 			throw std::invalid_argument("BaseLattice::(): uninitialised Mean and Var");
@@ -139,43 +677,51 @@ void BaseLattice::computeRhoTau(void)
 		double Tau = 0.5; // integrated autocorrelation time Tau(t)
 
 		// filenames to store Rho and Tau
-		char* filenameRho = (char*)"rho.dat";
-		char* filenameTau = (char*)"tau.dat";
+		std::string filenameRho = outputName("rho", ".dat");
+		std::string filenameTau = outputName("tau", ".dat");
 
 		// open files for writing
-		std::ofstream ofsRho(filenameRho, std::ofstream::out);
-		std::ofstream ofsTau(filenameTau, std::ofstream::out);
+		std::ofstream ofsRho(filenameRho.c_str(), std::ofstream::out);
+		std::ofstream ofsTau(filenameTau.c_str(), std::ofstream::out);
 
 		if (!ofsRho.is_open() || !ofsTau.is_open())
 			throw std::invalid_argument("BaseLattice::(): Error opening files!");
 	
 		// write the first values at t=0 to files
-		ofsRho << "0 " << Rho << std::endl;
-		ofsTau << "0 " << Tau << std::endl;
+		ofsRho << "0 " << Rho << "\n";
+		ofsTau << "0 " << Tau << "\n";
 	
 		// iterate through t from 1 to DELTA_TIME
 		for (int t = 1; t <= DELTA_TIME; t++)
 		{
-			Rt = 0.0;
+			if (XtMap != NULL)
+			{
+				Rt = 0.0;
+		
+				// compute R(delta) = E[(X(t) - u)(X(t+delta) - u)]
+				long i = 0;
+				while ((i + t) < nXtView)
+				{
+					Rt += (XtView[i * XtStride] - Mean)
+						* (XtView[(i + t) * XtStride] - Mean);
+					i += 1;
+				}
+				Rt = Rt / i;
 		
-			// compute R(delta) = E[X(t)X(t+delta)] - u^2
-			int i = 0;
-			while ((i + t) < Measures)
+				// Rho(t) = R(t) / (sigma^2)
+				Rho = Rt / Var;
+			}
+			else
 			{
-				Rt += Xt[i] * Xt[i + t];
-				i += 1;
+				Rho = Acf.rho(t);
 			}
-			Rt = Rt / i - Mean * Mean;
-		
-			// Rho(t) = R(t) / (sigma^2)
-			Rho = Rt / Var;
 		
 			// Tau(t) = 1/2 + sum(Rho(t))
 			Tau += Rho;
 		
 			// write data to files
-			ofsRho << t << " " << Rho << std::endl;
-			ofsTau << t << " " << Tau << std::endl;
+			ofsRho << t << " " << Rho << "\n";
+			ofsTau << t << " " << Tau << "\n";
 		}
 	
 		ofsRho.close();
@@ -18,12 +18,19 @@
 #include <math.h>
 #include <random>
 #include <fstream>
+#include <sstream>
+#include <string>
 #include <vector>
+#include <algorithm>
 #include <stdexcept>
 #include "mpi.h"
 
 #include "Field.h"
 #include "Communicator.h"
+#include "Checkpoint.h"
+#include "Snapshot.h"
+#include "TimeSeries.h"
+#include "Autocorrelation.h"
 
 
 // the max delta time for evaluating the
@@ -41,12 +48,21 @@ public:
 	virtual ~BaseLattice();
 
 	virtual void update(int numSweeps) = 0;
-	virtual void computeXt(void) = 0;
-	void retrieveXt(const char* filenameXt);
+	virtual void setBeta(double beta) = 0;
+	void thermalize(int numSweeps);
+	bool isStopped(void);
+	void measureLocal(double* sums);
+	void startPoint(int point);
+	virtual double computeX(double spinSum, double nGlobalSites);
+	virtual void computeXt(void);
+	void retrieveXt(const char* filenameXt, long first, long count, long stride);
 	void computeRhoTau(void);
-	void printLattice(void);
+	virtual void printLattice(void);
 
 protected:
+	// for subclasses that keep their own spin storage
+	BaseLattice(Machine* host, double beta, unsigned int seed);
+
 	int Size;       // size of the 2D lattice matrix
 	int nRow;       // # of rows of the lattice matrix
 	int nCol;       // # of cols of the lattice matrix
@@ -57,18 +73,49 @@ protected:
 	double Factor;  // different for metrop & worm
 	double Mean;    // Mean of the susceptibility
 	double Var;     // variance of the susceptibility
+	long Magnet;    // sum of the local spins
+	long Energy;    // bond energy of the local spins
 
-	std::vector<double> Xt;  // to store susceptibility
+	std::string Suffix;      // of the output files, or ""
 	std::mt19937 Generator;  // random number generator
 	std::uniform_real_distribution<double> UniformDist;
+	Autocorrelation Acf;     // Rho and Tau of X, online
+
+	// retrieveXt(): X of a mapped series file, every
+	// XtStride-th value from XtView on, instead of Acf
+	SeriesMap* XtMap;
+	const double* XtView;
+	long nXtView;
+	long XtStride;
 
+	Machine* Host;       // host processor
 	Field* Spins;        // the 2D lattice spin matrix
 	Communicator* Comms; // parallel data communication
 
+	Checkpoint* Ckp;     // checkpoint=N, or NULL
+	long Thrown;         // # of thermalization sweeps done
+	long Swept;          // # of sweeps done by computeXt()
+	bool Stopped;        // stopped at a checkpoint
+	Snapshot* Snap;      // snapshot=N, or NULL
+
 	virtual void updateLattice(int evenOddFlag) = 0;
 	void flipSpin(int row, int col);
 	virtual bool isAccept(int row, int col) = 0; // accept-reject process
-	int sumSpins(void);
+	std::string outputName(const char* name, const char* extension);
+	SeriesHeader seriesHeader(const char* name, int nColumns);
+	void reduceMeasures(std::vector<double>& localSums,
+						TimeSeries& seriesXt, TimeSeries& seriesEt);
+	void storeMeasure(double spinSum, double bondSum,
+					  TimeSeries& seriesXt, TimeSeries& seriesEt);
+	void addMeasure(double average);
+	virtual long sumSpins(void);
+	virtual long bondEnergy(void);
+	virtual double spinMeasure(void);
+	virtual unsigned int getCounter(void);
+	virtual void setCounter(unsigned int counter);
+	void saveCheckpoint(void);
+	void writeSnapshot(int measure);
+	bool restoreCheckpoint(void);
 };
 
 };
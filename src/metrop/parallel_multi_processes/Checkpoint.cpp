@@ -0,0 +1,281 @@
+/*=====================================================
+ * Checkpoint.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class
+ * Checkpoint, a checkpoint is written to a temporary
+ * file that replaces the last one when it is complete,
+ * so the file always holds a whole checkpoint
+ *=====================================================*/
+
+
+#include "Checkpoint.h"
+
+
+namespace wenchong
+{
+
+volatile sig_atomic_t Checkpoint::Terminated = 0;
+
+
+/*
+ * set up the view of the local lattice in the global
+ * one and catch SIGTERM of the batch scheduler
+ */
+Checkpoint::Checkpoint(Machine* host, Field* f, Communicator* comms)
+{
+	Host = host;
+	Spins = f;
+	Comms = comms;
+
+	Interval = host->CheckpointInterval;
+	Budget = host->WallTime;
+	Start = MPI_Wtime();
+	Last = Start;
+	Stopping = false;
+	StopRequest = MPI_REQUEST_NULL;
+
+	int sizes[2] = {f->nxGlobal, f->nyGlobal};
+	int subsizes[2] = {f->nxLocal, f->nyLocal};
+	int starts[2] = {f->xOffset, f->yOffset};
+
+	MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+							 MPI_SIGNED_CHAR, &Subarray);
+	MPI_Type_commit(&Subarray);
+
+	Buffer = new signed char[f->nData];
+
+	signal(SIGTERM, onTerminate);
+}
+
+
+/*
+ * destructor: release resources
+ */
+Checkpoint::~Checkpoint()
+{
+	signal(SIGTERM, SIG_DFL);
+
+	if (StopRequest != MPI_REQUEST_NULL)
+		Comms->waitGlobalSum(&StopRequest);
+
+	MPI_Type_free(&Subarray);
+	delete [] Buffer;
+}
+
+
+/*
+ * SIGTERM only sets a flag, the run stops at the
+ * next isDue() that all processes take part in
+ */
+void Checkpoint::onTerminate(int /*signal*/)
+{
+	Terminated = 1;
+}
+
+
+/*
+ * whether to write a checkpoint after count measures,
+ * every Interval measures, or when a process got
+ * SIGTERM or the wall time would be up, collective over
+ * the processes of the lattice: the flags are reduced
+ * without blocking and acted on at the next call, so
+ * the processes agree on the stop one call later
+ */
+bool Checkpoint::isDue(long count)
+{
+	double now = MPI_Wtime();
+
+	if (StopRequest != MPI_REQUEST_NULL)
+	{
+		Comms->waitGlobalSum(&StopRequest);
+		Stopping = (GlobalStop != 0);
+	}
+
+	// the stop takes effect two calls later,
+	// which come after about as long again each
+	LocalStop = (Terminated != 0);
+	if (Budget > 0.0 && (now - Start) + 2.0 * (now - Last) > Budget)
+		LocalStop = 1;
+
+	Last = now;
+
+	if (!Stopping)
+		Comms->startGlobalOr(&LocalStop, &GlobalStop, &StopRequest);
+
+	return Stopping || (count % Interval == 0);
+}
+
+
+/*
+ * whether the run stops at the last checkpoint
+ */
+bool Checkpoint::isStopping(void)
+{
+	return Stopping;
+}
+
+
+/*
+ * write a checkpoint: the header and the estimator
+ * state come from ROOT, the spins and the generators
+ * from all processes of the lattice
+ */
+void Checkpoint::write(CheckpointHeader& header, std::mt19937& generator,
+					   std::vector<double>& state)
+{
+	std::string temporary = std::string(Host->CheckpointFile) + ".tmp";
+	MPI_File fh;
+
+	check(MPI_File_open(Host->Comm, (char*)temporary.c_str(),
+						MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh),
+		  "open");
+	MPI_File_set_size(fh, 0);
+
+	if (Host->Rank == ROOT)
+		check(MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE,
+								MPI_STATUS_IGNORE), "write the header of");
+
+	// the spins through the view of the local lattice
+	packSpins();
+	MPI_File_set_view(fh, CHECKPOINT_HEADER, MPI_SIGNED_CHAR, Subarray,
+					  (char*)"native", MPI_INFO_NULL);
+	check(MPI_File_write_all(fh, Buffer, Spins->nData, MPI_SIGNED_CHAR,
+							 MPI_STATUS_IGNORE), "write the spins of");
+	MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, (char*)"native", MPI_INFO_NULL);
+
+	// the text state of the generator as words
+	unsigned int words[STATE_WORDS];
+	std::stringstream text;
+	text << generator;
+	for (int w = 0; w < STATE_WORDS; w++)
+		text >> words[w];
+
+	MPI_Offset offset = CHECKPOINT_HEADER
+					  + (MPI_Offset)Spins->nxGlobal * Spins->nyGlobal;
+
+	check(MPI_File_write_at_all(fh, offset + (MPI_Offset)Host->Rank * sizeof(words),
+								words, STATE_WORDS, MPI_UNSIGNED, MPI_STATUS_IGNORE),
+		  "write the generators of");
+
+	offset += (MPI_Offset)Host->nProc * sizeof(words);
+
+	if (Host->Rank == ROOT && !state.empty())
+		check(MPI_File_write_at(fh, offset, state.data(), (int)state.size(),
+								MPI_DOUBLE, MPI_STATUS_IGNORE), "write the estimator of");
+
+	MPI_File_close(&fh);
+
+	// all processes have written when the file is closed
+	if (Host->Rank == ROOT)
+		std::rename(temporary.c_str(), Host->CheckpointFile);
+}
+
+
+/*
+ * read the last checkpoint, false if there is none,
+ * the generators are restored if it was written by
+ * as many processes, otherwise they keep their seeds
+ */
+bool Checkpoint::read(CheckpointHeader& header, std::mt19937& generator,
+					  std::vector<double>& state)
+{
+	MPI_File fh;
+
+	if (MPI_File_open(Host->Comm, (char*)Host->CheckpointFile, MPI_MODE_RDONLY,
+					  MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+		return false;
+
+	check(MPI_File_read_at(fh, 0, &header, sizeof(header), MPI_BYTE,
+						   MPI_STATUS_IGNORE), "read the header of");
+
+	if (strncmp(header.Magic, "ISINGCK2", 8) != 0 ||
+		header.nxGlobal != Spins->nxGlobal || header.nyGlobal != Spins->nyGlobal)
+	{
+		if (Host->Rank == ROOT)
+			std::cout << Host->CheckpointFile << " is not a checkpoint of a "
+					  << Spins->nxGlobal << " x " << Spins->nyGlobal << " lattice\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	MPI_File_set_view(fh, CHECKPOINT_HEADER, MPI_SIGNED_CHAR, Subarray,
+					  (char*)"native", MPI_INFO_NULL);
+	check(MPI_File_read_all(fh, Buffer, Spins->nData, MPI_SIGNED_CHAR,
+							MPI_STATUS_IGNORE), "read the spins of");
+	MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, (char*)"native", MPI_INFO_NULL);
+	unpackSpins();
+
+	unsigned int words[STATE_WORDS];
+	MPI_Offset offset = CHECKPOINT_HEADER
+					  + (MPI_Offset)Spins->nxGlobal * Spins->nyGlobal;
+
+	if (header.nProc == Host->nProc)
+	{
+		check(MPI_File_read_at_all(fh, offset + (MPI_Offset)Host->Rank * sizeof(words),
+								   words, STATE_WORDS, MPI_UNSIGNED, MPI_STATUS_IGNORE),
+			  "read the generators of");
+
+		std::stringstream text;
+		for (int w = 0; w < STATE_WORDS; w++)
+			text << words[w] << " ";
+		text >> generator;
+	}
+
+	offset += (MPI_Offset)header.nProc * sizeof(words);
+
+	state.resize(header.nState);
+	if (!state.empty())
+		check(MPI_File_read_at(fh, offset, state.data(), (int)state.size(),
+							   MPI_DOUBLE, MPI_STATUS_IGNORE), "read the estimator of");
+
+	MPI_File_close(&fh);
+
+	return true;
+}
+
+
+/*
+ * copy the local spins to Buffer, row by row
+ */
+void Checkpoint::packSpins(void)
+{
+	for (int row = 0; row < Spins->nxLocal; row++)
+		for (int col = 0; col < Spins->nyLocal; col++)
+			Buffer[row * Spins->nyLocal + col] = (signed char)
+				Spins->Sites[(row + col) & 1][row * Spins->nyStride + (col >> 1)];
+}
+
+
+/*
+ * copy Buffer to the local spins, the ghost cells
+ * are left to a halo exchange
+ */
+void Checkpoint::unpackSpins(void)
+{
+	for (int row = 0; row < Spins->nxLocal; row++)
+		for (int col = 0; col < Spins->nyLocal; col++)
+			Spins->Sites[(row + col) & 1][row * Spins->nyStride + (col >> 1)] =
+				Buffer[row * Spins->nyLocal + col];
+}
+
+
+/*
+ * abort the run on an MPI-IO error
+ */
+void Checkpoint::check(int error, const char* what)
+{
+	if (error == MPI_SUCCESS)
+		return;
+
+	std::cout << "P" << Host->Rank << ": cannot " << what << " checkpoint "
+			  << Host->CheckpointFile << "\n";
+	MPI_Abort(MPI_COMM_WORLD, 1);
+}
+
+};
+
+
+/*================ End of File ================*/
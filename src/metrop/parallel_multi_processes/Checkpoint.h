@@ -0,0 +1,113 @@
+/*=====================================================
+ * Checkpoint.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the class Checkpoint that
+ * writes and reads the state of a run collectively
+ * with MPI-IO, in a layout that does not depend on
+ * the decomposition
+ *=====================================================*/
+
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+
+#include <random>
+#include <vector>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <signal.h>
+#include <stdint.h>
+#include "mpi.h"
+
+#include "Field.h"
+#include "Communicator.h"
+
+
+// bytes reserved for the header at the file start
+#define CHECKPOINT_HEADER 256
+
+
+namespace wenchong
+{
+
+/*
+ * the header of a checkpoint file, followed by
+ * - the spins of the global lattice, a signed char per
+ *   site, site (x, y) at byte x * nyGlobal + y
+ * - the state of the std::mt19937 of every process,
+ *   STATE_WORDS words per process in the order of Rank
+ * - the state of the online estimator of Rho and Tau
+ *   of X, nState doubles
+ */
+struct CheckpointHeader
+{
+	char Magic[8];      // "ISINGCK2"
+	char Algo[16];      // algo=... of the run
+	int32_t nxGlobal;   // # of points on global x-axis
+	int32_t nyGlobal;   // # of points on global y-axis
+	int32_t nProc;      // # of processes that wrote it
+	int32_t nSweeps;    // # of sweeps between two measures
+	uint32_t Seed;      // global seed of the run
+	uint32_t Counter;   // Philox counter of the algorithm
+	int64_t Thrown;     // # of thermalization sweeps done
+	int64_t Swept;      // # of measuring sweeps done
+	int64_t Measured;   // # of measures in the series
+	int64_t nState;     // # of doubles of the estimator state
+	double Beta;        // Beta = J/K(B)T
+};
+
+
+class Checkpoint
+{
+public:
+	Checkpoint(Machine* host, Field* f, Communicator* comms);
+	~Checkpoint();
+
+	// words of the text state of a std::mt19937
+	static const int STATE_WORDS = std::mt19937::state_size + 1;
+
+	bool isDue(long count);
+	bool isStopping(void);
+	void write(CheckpointHeader& header, std::mt19937& generator,
+			   std::vector<double>& state);
+	bool read(CheckpointHeader& header, std::mt19937& generator,
+			  std::vector<double>& state);
+
+private:
+	Machine* Host;         // host processor
+	Field* Spins;          // the local lattice
+	Communicator* Comms;   // to agree on stopping
+
+	int Interval;          // # of measures between checkpoints
+	double Budget;         // wall time of the run, or 0
+	double Start;          // wall time at construction
+	double Last;           // wall time of the last isDue()
+	bool Stopping;         // SIGTERM or wall time is up
+
+	// the OR of the stop flags of the last isDue(),
+	// in flight until the next one
+	int LocalStop;
+	int GlobalStop;
+	MPI_Request StopRequest;
+
+	MPI_Datatype Subarray; // local lattice in the global one
+	signed char* Buffer;   // local spins in natural order
+
+	void packSpins(void);
+	void unpackSpins(void);
+	void check(int error, const char* what);
+
+	static volatile sig_atomic_t Terminated;
+	static void onTerminate(int signal);
+};
+
+};
+
+
+#endif
@@ -20,10 +20,33 @@ namespace wenchong
  * constructor:
  * allocate resources to BoundaryComm structure
  */
-Communicator::Communicator()
+Communicator::Communicator(Machine* host)
 {
-	nSend = 0;
-	nRecv = 0;
+	Host = host;
+	Comm = host->Comm;
+
+	// halo=p2p (default): persistent sends and recvs,
+	// halo=neighbour: one neighbourhood collective
+	const char* halo = host->getOption("halo", "p2p");
+	Neighbourhood = (strcmp(halo, "neighbour") == 0);
+
+	if (!Neighbourhood && strcmp(halo, "p2p") != 0)
+	{
+		std::cout << "Unknown halo exchange: " << halo << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// with 1 or 2 processes on an axis both neighbours on
+	// it are the same process, the blocks of the collective
+	// cannot be told apart by some MPI libraries then
+	if (host->nx <= 2 || host->ny <= 2)
+		Neighbourhood = false;
+
+	FieldInit = NULL;
+	PackedInit = NULL;
+
+	Active = NULL;
+	nActive = 0;
 }
 
 
@@ -33,38 +56,315 @@ Communicator::Communicator()
  */
 Communicator::~Communicator()
 {
-	
+	waitBoundaryData();
+
+	if (FieldInit != NULL && !Neighbourhood)
+	{
+		freeRequests(FieldRequest[EVEN], 8);
+		freeRequests(FieldRequest[ODD], 8);
+	}
+
+	if (PackedInit != NULL)
+		freeRequests(PackedRequest, 8);
+}
+
+
+/*
+ * send the new boundary data of the updated parity
+ * and recv it straight into the ghost cells
+ */
+void Communicator::sendBoundaryData(Field* f, int evenOddFlag)
+{
+	startBoundaryData(f, evenOddFlag);
+	waitBoundaryData();
+}
+
+
+/*
+ * start the exchange of the boundary data of the
+ * updated parity and return at once, the boundary
+ * must not be written and the ghosts of the parity
+ * must not be read before waitBoundaryData()
+ */
+void Communicator::startBoundaryData(Field* f, int evenOddFlag)
+{
+	if (Neighbourhood)
+	{
+		if (f != FieldInit)
+			initNeighbourData(f);
+
+		MPI_Ineighbor_alltoallw(MPI_BOTTOM, Counts, SendDispl[evenOddFlag], Types,
+								MPI_BOTTOM, Counts, RecvDispl[evenOddFlag], Types,
+								Comm, &NeighbourRequest);
+
+		Active = &NeighbourRequest;
+		nActive = 1;
+		return;
+	}
+
+	if (f != FieldInit)
+		initBoundaryData(f);
+
+	MPI_Startall(8, FieldRequest[evenOddFlag]);
+
+	Active = FieldRequest[evenOddFlag];
+	nActive = 8;
+}
+
+
+/*
+ * wait for the exchange started by startBoundaryData(),
+ * nothing to do if no exchange is started, the matching
+ * sends and recvs of the neighbours are all the
+ * synchronisation the next half sweep needs
+ */
+void Communicator::waitBoundaryData(void)
+{
+	// wait for local jobs to complete
+	MPI_Waitall(nActive, Active, MPI_STATUSES_IGNORE);
+
+	Active = NULL;
+	nActive = 0;
+}
+
+
+/*
+ * exchange the bands of depth nGhost of both parities,
+ * East/West first, then North/South with the ghost rows
+ * just received, which fills the corners of the halo,
+ * the band sent to dir is received by the neighbour
+ * from its opposite direction with tag 1200 + dir
+ */
+void Communicator::sendBoundaryBands(Field* f)
+{
+	const int opposite[4] = {SOUTH, NORTH, WEST, EAST};
+	const int phases[2][2] = {{EAST, WEST}, {NORTH, SOUTH}};
+	MPI_Request request[4];
+
+	for (int phase = 0; phase < 2; phase++)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			int dir = phases[phase][i];
+
+			MPI_Isend(MPI_BOTTOM, 1, f->SendBand[dir], f->Host->Neighbour[dir],
+					  1200 + dir, Comm, request + 2 * i);
+
+			MPI_Irecv(MPI_BOTTOM, 1, f->RecvBand[dir], f->Host->Neighbour[dir],
+					  1200 + opposite[dir], Comm, request + 2 * i + 1);
+		}
+
+		// wait for local jobs to complete
+		MPI_Waitall(4, request, MPI_STATUSES_IGNORE);
+	}
 }
 
 
 /*
- * send and recv new boundary data
+ * send and recv new packed boundary data,
+ * the boundary to direction dir is received by
+ * the neighbour into its opposite direction
  */
-void Communicator::sendBoundaryData(Field* f)
+void Communicator::sendBoundaryData(PackedField* f)
 {
-	sendToEast(f);
-	sendToWest(f);
-	sendToNorth(f);
-	sendToSouth(f);
+	if (f != PackedInit)
+		initBoundaryData(f);
+
+	MPI_Startall(8, PackedRequest);
 
 	// wait for local jobs to complete
-	MPI_Waitall(nSend, SendRequest, SendStatus);
-	MPI_Waitall(nRecv, RecvRequest, RecvStatus);
+	MPI_Waitall(8, PackedRequest, MPI_STATUSES_IGNORE);
+}
+
+
+/*
+ * send count[dir] labels of the boundary sites to the
+ * neighbour dir and recv the labels of its boundary
+ * sites facing this process into recvLabels[dir]
+ */
+void Communicator::sendBoundaryLabels(long* sendLabels[4], long* recvLabels[4],
+									  const int count[4])
+{
+	const int opposite[4] = {SOUTH, NORTH, WEST, EAST};
+	MPI_Request request[8];
+
+	for (int dir = 0; dir < 4; dir++)
+	{
+		MPI_Isend(sendLabels[dir], count[dir], MPI_LONG, Host->Neighbour[dir],
+				  1300 + dir, Comm, request + 2 * dir);
+
+		MPI_Irecv(recvLabels[dir], count[dir], MPI_LONG, Host->Neighbour[dir],
+				  1300 + opposite[dir], Comm, request + 2 * dir + 1);
+	}
+
+	// wait for local jobs to complete
+	MPI_Waitall(8, request, MPI_STATUSES_IGNORE);
+}
+
+
+/*
+ * true on all processes if local is true on any
+ */
+bool Communicator::computeGlobalOr(bool local)
+{
+	int value = local ? 1 : 0;
+	int global = 0;
+
+	MPI_Allreduce(&value, &global, 1, MPI_INT, MPI_LOR, Comm);
+
+	return global != 0;
+}
+
+
+/*
+ * sum count values, e.g. the spins and the bond energy,
+ * of the lattice system globally in one reduction
+ */
+void Communicator::computeGlobalSum(double* localSum, double* globalSum, int count)
+{
+	MPI_Allreduce(localSum, globalSum, count, MPI_DOUBLE, MPI_SUM, Comm);
+}
+
+
+/*
+ * gather count values of every replica, in the order
+ * of the replicas, on the processes of all replicas
+ */
+void Communicator::gatherReplicas(double* localSum, double* allSums, int count)
+{
+	MPI_Allgather(localSum, count, MPI_DOUBLE, allSums, count, MPI_DOUBLE,
+				  Host->Replicas);
+}
+
+
+/*
+ * start computeGlobalSum() and return at once, the
+ * buffers must be kept until waitGlobalSum(request)
+ */
+void Communicator::startGlobalSum(double* localSum, double* globalSum, int count,
+								  MPI_Request* request)
+{
+	MPI_Iallreduce(localSum, globalSum, count, MPI_DOUBLE, MPI_SUM, Comm, request);
+}
+
+
+/*
+ * wait for a reduction started by startGlobalSum()
+ * or startGlobalOr()
+ */
+void Communicator::waitGlobalSum(MPI_Request* request)
+{
+	MPI_Wait(request, MPI_STATUS_IGNORE);
+}
+
+
+/*
+ * start computeGlobalOr() of *local and return at once,
+ * *global is set when waitGlobalSum(request) returns
+ */
+void Communicator::startGlobalOr(int* local, int* global, MPI_Request* request)
+{
+	MPI_Iallreduce(local, global, 1, MPI_INT, MPI_LOR, Comm, request);
+}
+
+
+/*
+ * sum count values of all processes on ROOT only,
+ * rootSum is not used on the other processes
+ */
+void Communicator::reduceToRoot(double* localSum, double* rootSum, int count)
+{
+	MPI_Reduce(localSum, rootSum, count, MPI_DOUBLE, MPI_SUM, ROOT, Comm);
+}
+
+
+/*
+ * set up the persistent requests of both parities of f,
+ * the boundaries and ghosts of a Field do not move
+ */
+void Communicator::initBoundaryData(Field* f)
+{
+	if (FieldInit != NULL)
+	{
+		freeRequests(FieldRequest[EVEN], 8);
+		freeRequests(FieldRequest[ODD], 8);
+	}
+
+	for (int flag = EVEN; flag <= ODD; flag++)
+	{
+		sendToEast(f, flag, FieldRequest[flag]);
+		sendToWest(f, flag, FieldRequest[flag] + 2);
+		sendToNorth(f, flag, FieldRequest[flag] + 4);
+		sendToSouth(f, flag, FieldRequest[flag] + 6);
+	}
+
+	FieldInit = f;
+}
+
+
+/*
+ * set up the addresses of the neighbourhood collective,
+ * the boundary to direction dir is sent to the neighbour
+ * in dir and the ghosts in dir are received from it
+ */
+void Communicator::initNeighbourData(Field* f)
+{
+	const int order[4] = {SOUTH, NORTH, WEST, EAST};
+
+	for (int i = 0; i < 4; i++)
+	{
+		int dir = order[i];
+
+		Counts[i] = 1;
+		Types[i] = (dir == NORTH || dir == SOUTH) ? f->ColumnType : f->RowType;
+
+		for (int flag = EVEN; flag <= ODD; flag++)
+		{
+			MPI_Get_address(f->boundary(dir, flag), &SendDispl[flag][i]);
+			MPI_Get_address(f->ghost(dir, flag), &RecvDispl[flag][i]);
+		}
+	}
+
+	FieldInit = f;
+}
+
+
+/*
+ * set up the persistent requests of the packed buffers,
+ * the boundary to direction dir is received by the
+ * neighbour into its opposite direction
+ */
+void Communicator::initBoundaryData(PackedField* f)
+{
+	const int opposite[4] = {SOUTH, NORTH, WEST, EAST};
+
+	if (PackedInit != NULL)
+		freeRequests(PackedRequest, 8);
+
+	for (int dir = 0; dir < 4; dir++)
+	{
+		int count = (dir == NORTH || dir == SOUTH) ? f->nxBuffer : f->nyBuffer;
+
+		MPI_Send_init(f->SendBuffer[dir], count, MPI_UINT64_T,
+					  f->Host->Neighbour[dir], 1100 + dir, Comm,
+					  PackedRequest + 2 * dir);
 
-	MPI_Barrier(MPI_COMM_WORLD);
+		MPI_Recv_init(f->RecvBuffer[opposite[dir]], count, MPI_UINT64_T,
+					  f->Host->Neighbour[opposite[dir]], 1100 + dir, Comm,
+					  PackedRequest + 2 * dir + 1);
+	}
 
-	nSend = 0;
-	nRecv = 0;
+	PackedInit = f;
 }
 
 
 /*
- * sum all the spin values in the lattice system globally
+ * free inactive persistent requests
  */
-void Communicator::computeGlobalSum(double* localSum, double* globalSum)
+void Communicator::freeRequests(MPI_Request* request, int count)
 {
-	MPI_Allreduce(localSum, globalSum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-	MPI_Barrier(MPI_COMM_WORLD);
+	for (int i = 0; i < count; i++)
+		MPI_Request_free(request + i);
 }
 
 
@@ -72,19 +372,17 @@ void Communicator::computeGlobalSum(double* localSum, double* globalSum)
  * send data to east
  * recv data from west
  */
-void Communicator::sendToEast(Field* f)
+void Communicator::sendToEast(Field* f, int evenOddFlag, MPI_Request* request)
 {
 	// send east boundary to east
-	MPI_Isend(f->SendBuffer[EAST], f->nyBuffer, MPI_INT,
-			  f->Host->Neighbour[EAST], 1000, MPI_COMM_WORLD,
-			  SendRequest + nSend);
-	nSend++;
+	MPI_Send_init(f->boundary(EAST, evenOddFlag), 1, f->RowType,
+				  f->Host->Neighbour[EAST], 1000 + 4 * evenOddFlag, Comm,
+				  request);
 
 	// recv west boundary from west
-	MPI_Irecv(f->RecvBuffer[WEST], f->nyBuffer, MPI_INT,
-			  f->Host->Neighbour[WEST], 1000, MPI_COMM_WORLD,
-			  RecvRequest + nRecv);
-	nRecv++;
+	MPI_Recv_init(f->ghost(WEST, evenOddFlag), 1, f->RowType,
+				  f->Host->Neighbour[WEST], 1000 + 4 * evenOddFlag, Comm,
+				  request + 1);
 }
 
 
@@ -92,19 +390,17 @@ void Communicator::sendToEast(Field* f)
  * send data to west
  * recv data from east
  */
-void Communicator::sendToWest(Field* f)
+void Communicator::sendToWest(Field* f, int evenOddFlag, MPI_Request* request)
 {
 	// send west boundary data to west
-	MPI_Isend(f->SendBuffer[WEST], f->nyBuffer, MPI_INT,
-			  f->Host->Neighbour[WEST], 1001, MPI_COMM_WORLD,
-			  SendRequest + nSend);
-	nSend++;
+	MPI_Send_init(f->boundary(WEST, evenOddFlag), 1, f->RowType,
+				  f->Host->Neighbour[WEST], 1001 + 4 * evenOddFlag, Comm,
+				  request);
 
 	// recv east boundary from east
-	MPI_Irecv(f->RecvBuffer[EAST], f->nyBuffer, MPI_INT,
-			  f->Host->Neighbour[EAST], 1001, MPI_COMM_WORLD,
-			  RecvRequest + nRecv);
-	nRecv++;
+	MPI_Recv_init(f->ghost(EAST, evenOddFlag), 1, f->RowType,
+				  f->Host->Neighbour[EAST], 1001 + 4 * evenOddFlag, Comm,
+				  request + 1);
 }
 
 
@@ -112,19 +408,17 @@ void Communicator::sendToWest(Field* f)
  * send data to north
  * recv data from south
  */
-void Communicator::sendToNorth(Field* f)
+void Communicator::sendToNorth(Field* f, int evenOddFlag, MPI_Request* request)
 {
 	// send north boundary data to north
-	MPI_Isend(f->SendBuffer[NORTH], f->nxBuffer, MPI_INT,
-			  f->Host->Neighbour[NORTH], 1002, MPI_COMM_WORLD,
-			  SendRequest + nSend);
-	nSend++;
+	MPI_Send_init(f->boundary(NORTH, evenOddFlag), 1, f->ColumnType,
+				  f->Host->Neighbour[NORTH], 1002 + 4 * evenOddFlag, Comm,
+				  request);
 
 	// recv south boundary from south
-	MPI_Irecv(f->RecvBuffer[SOUTH], f->nxBuffer, MPI_INT,
-			  f->Host->Neighbour[SOUTH], 1002, MPI_COMM_WORLD,
-			  RecvRequest + nRecv);
-	nRecv++;
+	MPI_Recv_init(f->ghost(SOUTH, evenOddFlag), 1, f->ColumnType,
+				  f->Host->Neighbour[SOUTH], 1002 + 4 * evenOddFlag, Comm,
+				  request + 1);
 }
 
 
@@ -132,22 +426,20 @@ void Communicator::sendToNorth(Field* f)
  * send data to south
  * recv data from north
  */
-void Communicator::sendToSouth(Field* f)
+void Communicator::sendToSouth(Field* f, int evenOddFlag, MPI_Request* request)
 {
 	// send south boundary data to south
-	MPI_Isend(f->SendBuffer[SOUTH], f->nxBuffer, MPI_INT,
-			  f->Host->Neighbour[SOUTH], 1003, MPI_COMM_WORLD,
-			  SendRequest + nSend);
-	nSend++;
+	MPI_Send_init(f->boundary(SOUTH, evenOddFlag), 1, f->ColumnType,
+				  f->Host->Neighbour[SOUTH], 1003 + 4 * evenOddFlag, Comm,
+				  request);
 
 	// recv north boundary data from norths
-	MPI_Irecv(f->RecvBuffer[NORTH], f->nxBuffer, MPI_INT,
-			  f->Host->Neighbour[NORTH], 1003, MPI_COMM_WORLD,
-			  RecvRequest + nRecv);
-	nRecv++;
+	MPI_Recv_init(f->ghost(NORTH, evenOddFlag), 1, f->ColumnType,
+				  f->Host->Neighbour[NORTH], 1003 + 4 * evenOddFlag, Comm,
+				  request + 1);
 }
 
 };
 
 
-/*================ End of File ================*/
\ No newline at end of file
+/*================ End of File ================*/
@@ -17,6 +17,7 @@
 #include "mpi.h"
 
 #include "Field.h"
+#include "PackedField.h"
 
 
 namespace wenchong
@@ -25,27 +26,61 @@ namespace wenchong
 class Communicator
 {
 public:
-	Communicator();
+	Communicator(Machine* host);
 	~Communicator();
 
-	void sendBoundaryData(Field* f);
-	void computeGlobalSum(double* localSum, double* globalSum);
+	void sendBoundaryData(Field* f, int evenOddFlag);
+	void startBoundaryData(Field* f, int evenOddFlag);
+	void waitBoundaryData(void);
+	void sendBoundaryBands(Field* f);
+	void sendBoundaryData(PackedField* f);
+	void sendBoundaryLabels(long* sendLabels[4], long* recvLabels[4],
+							const int count[4]);
+	bool computeGlobalOr(bool local);
+	void computeGlobalSum(double* localSum, double* globalSum, int count);
+	void reduceToRoot(double* localSum, double* rootSum, int count);
+	void gatherReplicas(double* localSum, double* allSums, int count);
+	void startGlobalSum(double* localSum, double* globalSum, int count,
+						MPI_Request* request);
+	void waitGlobalSum(MPI_Request* request);
+	void startGlobalOr(int* local, int* global, MPI_Request* request);
 
 private:
-	int nSend;
-	int nRecv;
-
-	MPI_Request SendRequest[4];
-	MPI_Request RecvRequest[4];
-
-	MPI_Status SendStatus[4];
-	MPI_Status RecvStatus[4];
+	Machine* Host;         // host processor
+	MPI_Comm Comm;         // Cartesian grid of the Machine
+	bool Neighbourhood;    // halo=neighbour: one collective
+
+	// persistent requests of the halo exchanges, set up
+	// on the first exchange of a field and started on
+	// every later one, a send and a recv per direction
+	Field* FieldInit;
+	PackedField* PackedInit;
+
+	MPI_Request FieldRequest[2][8];  // of the even/odd sites
+	MPI_Request PackedRequest[8];
+
+	// halo=neighbour: the boundaries and ghosts of a
+	// parity by address, in the neighbour order of the
+	// Cartesian grid: SOUTH, NORTH, WEST, EAST
+	int Counts[4];
+	MPI_Datatype Types[4];
+	MPI_Aint SendDispl[2][4];
+	MPI_Aint RecvDispl[2][4];
+	MPI_Request NeighbourRequest;
+
+	MPI_Request* Active;  // started requests to wait for
+	int nActive;
+
+	void initBoundaryData(Field* f);
+	void initNeighbourData(Field* f);
+	void initBoundaryData(PackedField* f);
+	void freeRequests(MPI_Request* request, int count);
 
 	// to exchage data with neighbours
-	void sendToEast(Field* f);
-	void sendToWest(Field* f);
-	void sendToNorth(Field* f);
-	void sendToSouth(Field* f);
+	void sendToEast(Field* f, int evenOddFlag, MPI_Request* request);
+	void sendToWest(Field* f, int evenOddFlag, MPI_Request* request);
+	void sendToNorth(Field* f, int evenOddFlag, MPI_Request* request);
+	void sendToSouth(Field* f, int evenOddFlag, MPI_Request* request);
 };
 
 };
@@ -32,46 +32,96 @@ Field::Field(Machine* m)
 
 	// active Data size
 	nData = nxLocal * nyLocal;
+	nyHalf = nyLocal / 2;
 
-	Data = new int[nData];
+	// a row is [padding][ghost][nyHalf sites][ghost][padding],
+	// the sites start on a cache line (16 ints), and a stride
+	// of a multiple of 512 ints is avoided so that the rows
+	// of power-of-two lattices do not alias in the cache
+	int padding = (kGhost + 15) / 16 * 16;
 
-	// compute buffer sizes
-	nxBuffer = nxLocal / 2 + 1;
-	nyBuffer = nyLocal / 2 + 1;
+	nyStride = (padding + nyHalf + kGhost + 15) / 16 * 16;
+	if (nyStride % 512 == 0)
+		nyStride += 16;
 
-	SendBuffer[NORTH] = new int[nxBuffer];
-	SendBuffer[SOUTH] = new int[nxBuffer];
-	SendBuffer[EAST]  = new int[nyBuffer];
-	SendBuffer[WEST]  = new int[nyBuffer];
+	int nMemory = (nxLocal + 2 * nGhost) * nyStride + 16;
 
-	RecvBuffer[NORTH] = new int[nxBuffer];
-	RecvBuffer[SOUTH] = new int[nxBuffer];
-	RecvBuffer[EAST]  = new int[nyBuffer];
-	RecvBuffer[WEST]  = new int[nyBuffer];
+	for (int p = 0; p < 2; p++)
+	{
+		Memory[p] = new int[nMemory];
+
+		// align row 0 to 64 bytes
+		int* aligned = (int*)(((size_t)Memory[p] + 63) & ~(size_t)63);
+		Sites[p] = aligned + nGhost * nyStride + padding;
+	}
+
+	// a parity has nyHalf sites on a row and
+	// one site on every second row of a column
+	MPI_Type_contiguous(nyHalf, MPI_INT, &RowType);
+	MPI_Type_commit(&RowType);
+
+	MPI_Type_vector(nxLocal / 2, 1, 2 * nyStride, MPI_INT, &ColumnType);
+	MPI_Type_commit(&ColumnType);
+
+	if (nGhost > 1)
+		createBands();
 }
 
 
 /*
- * init data and boundary data
+ * create the types of the bands of depth nGhost, a band
+ * is a block of rows of each parity at its address,
+ * sent and received from MPI_BOTTOM
  */
-void Field::init(int initVal)
+void Field::createBands(void)
 {
-	// init lattice data
-	for (int i = 0; i < nData; i++)
-		Data[i] = initVal;
+	MPI_Datatype rowBand, columnBand;
+
+	// nGhost rows of nyHalf sites, and kGhost sites
+	// of all nxLocal + 2 * nGhost rows
+	MPI_Type_vector(nGhost, nyHalf, nyStride, MPI_INT, &rowBand);
+	MPI_Type_vector(nxLocal + 2 * nGhost, kGhost, nyStride, MPI_INT, &columnBand);
 
-	// init boundary data/receive buffer
-	for (int i = 0; i < 4; i++)
+	for (int dir = 0; dir < 4; dir++)
 	{
-		if (i == NORTH || i == SOUTH)
+		MPI_Datatype band = (dir == NORTH || dir == SOUTH) ? columnBand : rowBand;
+		MPI_Datatype types[2] = {band, band};
+		int lengths[2] = {1, 1};
+		MPI_Aint send[2], recv[2];
+
+		for (int p = 0; p < 2; p++)
 		{
-			for (int j = 0; j < nxBuffer; j++)
-				RecvBuffer[i][j] = initVal;
+			MPI_Get_address(boundaryBand(dir, p), &send[p]);
+			MPI_Get_address(ghostBand(dir, p), &recv[p]);
 		}
-		else
+
+		MPI_Type_create_struct(2, lengths, send, types, &SendBand[dir]);
+		MPI_Type_commit(&SendBand[dir]);
+
+		MPI_Type_create_struct(2, lengths, recv, types, &RecvBand[dir]);
+		MPI_Type_commit(&RecvBand[dir]);
+	}
+
+	MPI_Type_free(&rowBand);
+	MPI_Type_free(&columnBand);
+}
+
+
+/*
+ * init data and boundary data
+ */
+void Field::init(int initVal)
+{
+	// init lattice data and ghost cells, the rows are
+	// touched first by the threads that update them, so
+	// the pages are placed on the NUMA node of the thread
+	#pragma omp parallel for schedule(static)
+	for (int i = -nGhost; i < nxLocal + nGhost; i++)
+	{
+		for (int k = -kGhost; k < nyHalf + kGhost; k++)
 		{
-			for (int j = 0; j < nyBuffer; j++)
-				RecvBuffer[i][j] = initVal;
+			Sites[EVEN][i * nyStride + k] = initVal;
+			Sites[ODD][i * nyStride + k] = initVal;
 		}
 	}
 }
@@ -82,100 +132,177 @@ void Field::init(int initVal)
  */
 Field::~Field()
 {
-	delete [] Data;
+	delete [] Memory[EVEN];
+	delete [] Memory[ODD];
+
+	MPI_Type_free(&RowType);
+	MPI_Type_free(&ColumnType);
 
-	for (int i = 0; i < 4; i++)
+	if (nGhost > 1)
 	{
-		delete [] SendBuffer[i];
-		delete [] RecvBuffer[i];
+		for (int dir = 0; dir < 4; dir++)
+		{
+			MPI_Type_free(&SendBand[dir]);
+			MPI_Type_free(&RecvBand[dir]);
+		}
 	}
 }
 
 
 /*
  * get the value of spin at given (row, col),
- * may need boundary data from receive buffers
+ * row, col < 0 or row >= nxLocal, col >= nyLocal are ghosts
  */
 int& Field::operator() (int row, int col)
 {
-	if (row > nxLocal || row < -1 || col > nyLocal || col < -1)
+	if (row >= nxLocal + nGhost || row < -nGhost ||
+		col >= nyLocal + nGhost || col < -nGhost)
 	{
 		throw std::out_of_range("Field::(): row and col our of bounds");
 		MPI_Abort(MPI_COMM_WORLD, 1);
 	}
 
-	// get data from North buffer
-	if (col == nyLocal)
-		return RecvBuffer[NORTH][row / 2];
+	// floor(col / 2), also for col < 0
+	int k = (col + 2 * nGhost) / 2 - nGhost;
 
-	// get data from South buffer
-	if (col == -1)
-		return RecvBuffer[SOUTH][row / 2];
+	return Sites[(row + col + 2 * nGhost) % 2][row * nyStride + k];
+}
 
-	// get data from East buffer
-	if (row == nxLocal)
-		return RecvBuffer[EAST][col / 2];
 
-	// get data from West buffer
-	if (row == -1)
-		return RecvBuffer[WEST][col / 2];
+/*
+ * the boundary sites of parity evenOddFlag:
+ * - West/East are rows 0 and nxLocal-1, one RowType
+ * - South/North are cols 0 and nyLocal-1, one ColumnType
+ */
+int* Field::boundary(int dir, int evenOddFlag)
+{
+	int* sites = Sites[evenOddFlag];
 
-	// get data from local Data array
-	return Data[row * nyLocal + col];
+	switch (dir)
+	{
+		case WEST:
+			return sites;
+		case EAST:
+			return sites + (nxLocal - 1) * nyStride;
+		case SOUTH:
+			return sites + evenOddFlag * nyStride;
+		default:
+			return sites + (1 - evenOddFlag) * nyStride + nyHalf - 1;
+	}
 }
 
 
 /*
- * sum up all values of spin in the lattice
+ * the ghost sites of parity evenOddFlag:
+ * - West/East are rows -1 and nxLocal, one RowType
+ * - South/North are cols -1 and nyLocal, one ColumnType
  */
-int Field::sumData(void)
+int* Field::ghost(int dir, int evenOddFlag)
 {
-	int sum = 0;
-
-	for (int i = 0; i < nxLocal; i++)
-		for (int j = 0; j < nyLocal; j++)
-			sum += Data[i * nyLocal + j];
+	int* sites = Sites[evenOddFlag];
 
-	return sum;
+	switch (dir)
+	{
+		case WEST:
+			return sites - nyStride;
+		case EAST:
+			return sites + nxLocal * nyStride;
+		case SOUTH:
+			return sites + (1 - evenOddFlag) * nyStride - 1;
+		default:
+			return sites + evenOddFlag * nyStride + nyHalf;
+	}
 }
 
 
 /*
- * pack boundary data into the send buffers
+ * the bands of depth nGhost of parity evenOddFlag:
+ * - West/East are rows 0, ..., nGhost-1 and
+ *   nxLocal-nGhost, ..., nxLocal-1 with the local columns
+ * - South/North are k = 0, ..., kGhost-1 and
+ *   nyHalf-kGhost, ..., nyHalf-1 of all rows with ghosts
  */
-void Field::packBuffer(int evenOddFlag)
+int* Field::boundaryBand(int dir, int evenOddFlag)
 {
-	int row, col, start;
-
-	start = evenOddFlag % 2;
+	int* sites = Sites[evenOddFlag];
 
-	// pack data to West buffer
-	for (int y = start; y < nyLocal; y += 2)
+	switch (dir)
 	{
-		SendBuffer[WEST][y / 2] = Data[y];
+		case WEST:
+			return sites;
+		case EAST:
+			return sites + (nxLocal - nGhost) * nyStride;
+		case SOUTH:
+			return sites - nGhost * nyStride;
+		default:
+			return sites - nGhost * nyStride + nyHalf - kGhost;
 	}
+}
 
-	// pack data to South buffer
-	for (int x = start; x < nxLocal; x += 2)
-	{
-		SendBuffer[SOUTH][x / 2] = Data[x * nyLocal];
-	}
 
-	// pack data to East buffer
-	row = nxLocal - 1;
-	start = (row + evenOddFlag) % 2;
-	for (int y = start; y < nyLocal; y += 2)
+/*
+ * the ghost bands of depth nGhost of parity evenOddFlag,
+ * the layout of boundaryBand() beyond the local lattice
+ */
+int* Field::ghostBand(int dir, int evenOddFlag)
+{
+	int* sites = Sites[evenOddFlag];
+
+	switch (dir)
 	{
-		SendBuffer[EAST][y / 2] = Data[row * nyLocal + y];
+		case WEST:
+			return sites - nGhost * nyStride;
+		case EAST:
+			return sites + nxLocal * nyStride;
+		case SOUTH:
+			return sites - nGhost * nyStride - kGhost;
+		default:
+			return sites - nGhost * nyStride + nyHalf;
 	}
+}
+
+
+/*
+ * sum up all values of spin in the lattice
+ */
+int Field::sumData(void)
+{
+	int sum = 0;
+
+	#pragma omp parallel for schedule(static) reduction(+:sum)
+	for (int i = 0; i < nxLocal; i++)
+		for (int k = 0; k < nyHalf; k++)
+			sum += Sites[EVEN][i * nyStride + k] + Sites[ODD][i * nyStride + k];
+
+	return sum;
+}
+
+
+/*
+ * sum si * sj over the bonds of the local sites to
+ * their right and lower neighbours, which may be ghosts
+ */
+long Field::sumBonds(void)
+{
+	long sum = 0;
 
-	// pack data to North buffer
-	col = nyLocal - 1;
-	start = (col + evenOddFlag) % 2;
-	for (int x = start; x < nxLocal; x += 2)
+	#pragma omp parallel for schedule(static) reduction(+:sum)
+	for (int i = 0; i < nxLocal; i++)
 	{
-		SendBuffer[NORTH][x / 2] = Data[x * nyLocal + col];
+		for (int p = EVEN; p <= ODD; p++)
+		{
+			// right neighbour at k+start, lower one at k
+			// of the other parity
+			int start = (i + p) % 2;
+			int* row = Sites[p] + i * nyStride;
+			int* other = Sites[1 - p] + i * nyStride;
+
+			for (int k = 0; k < nyHalf; k++)
+				sum += row[k] * (other[k + start] + other[k + nyStride]);
+		}
 	}
+
+	return sum;
 }
 
 
@@ -209,6 +336,27 @@ void Field::checkGrid(void)
 		MPI_Abort(MPI_COMM_WORLD, 1);
 	}
 
+	// a row or a column holds the same # of even and odd sites
+	if (nxLocal % 2 != 0 || nyLocal % 2 != 0)
+	{
+		std::cout << "Local grid " << nxLocal << " x " << nyLocal
+				  << " is not even\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// a halo of D sweeps is 2 * D sites deep, as a half
+	// sweep spoils one layer, and comes from the neighbours
+	nGhost = (Host->HaloDepth > 1) ? 2 * Host->HaloDepth : 1;
+	kGhost = (nGhost + 1) / 2;
+
+	if (nGhost > nxLocal || nGhost > nyLocal)
+	{
+		std::cout << "Halo depth " << Host->HaloDepth
+				  << " is too deep for local grid "
+				  << nxLocal << " x " << nyLocal << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
 	// compute offsets relative to global coor system
 	xOffset = Host->x * nxLocal;
 	yOffset = Host->y * nyLocal;
@@ -31,6 +31,19 @@
 namespace wenchong
 {
 
+/*
+ * the sites are stored in red/black order: site (row, col)
+ * of parity p = (row + col) % 2 is Sites[p][row * nyStride + k]
+ * with k = floor(col / 2), so the sites of a half sweep
+ * and their neighbours are both contiguous,
+ * each sublattice has a frame of ghost cells at
+ * row = -1, nxLocal and k = -1, nyHalf holding the
+ * boundary data of the neighbours,
+ * with a halo depth of D sweeps the frame is
+ * nGhost = 2 * D sites wide: rows -nGhost, ..., -1 and
+ * nxLocal, ..., nxLocal+nGhost-1, and kGhost = D sites
+ * of a parity on both sides of a row
+ */
 class Field
 {
 public:
@@ -39,8 +52,18 @@ public:
 
 	void init(int initVal); // init Data array
 	int sumData(void);      // sum data in Data array
+	long sumBonds(void);    // sum of si * sj over the bonds
 	int& operator() (int row, int col);
-	void packBuffer(int evenOddFlag); // pack boundary to send
+
+	// first boundary site of the given parity to send
+	// to dir, and first ghost site to receive from dir
+	int* boundary(int dir, int evenOddFlag);
+	int* ghost(int dir, int evenOddFlag);
+
+	// first site of the band of width nGhost to send to
+	// dir, and of the ghost band to receive from dir
+	int* boundaryBand(int dir, int evenOddFlag);
+	int* ghostBand(int dir, int evenOddFlag);
 
 	int nxGlobal;       // # of points on global x-axis
 	int nyGlobal;       // # of points on global y-axis
@@ -48,21 +71,32 @@ public:
 	int nData;          // # of active/local data
 	int nxLocal;        // # of points on local x-axis
 	int nyLocal;        // # of points on local y-axis
+	int nyHalf;         // # of points of a parity on a row
+	int nyStride;       // padded row length incl. ghosts
+	int nGhost;         // # of ghost layers around
+	int kGhost;         // # of ghost sites of a parity on a row side
 
 	int xOffset;        // offset relative to global x-axis
 	int yOffset;        // offset relative to global y-axis
-	
-	int nxBuffer;       // buffer size of x axis
-	int nyBuffer;       // buffer size of y axis
 
-	int* Data;          // data in the Field
-	int* SendBuffer[4]; // buffer of boundary data to send
-	int* RecvBuffer[4]; // buffer of boundary data to receive
+	int* Sites[2];      // EVEN and ODD sites at (0, 0)
+
+	MPI_Datatype RowType;    // East/West boundary of a parity
+	MPI_Datatype ColumnType; // North/South boundary of a parity
+
+	// bands of both parities by address, for halo
+	// depths > 1: East/West bands hold the local columns,
+	// North/South bands all rows incl. the ghost rows
+	MPI_Datatype SendBand[4];
+	MPI_Datatype RecvBand[4];
 
 	Machine* Host;      // host processor
 
 private:
+	int* Memory[2];     // allocated sublattices with ghosts
+
 	void checkGrid(void); // check Grid and Machine compatability
+	void createBands(void);
 };
 
 };
@@ -0,0 +1,95 @@
+/*=====================================================
+ * HeatBath.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class HeatBath
+ * that implements the heat-bath algorithm, a site is
+ * set to +1 or -1 by the probabilities given by its
+ * neighbours, whatever its current value
+ *=====================================================*/
+
+
+#include "HeatBath.h"
+
+
+namespace wenchong
+{
+
+/*
+ * construct the 2D lattice system, the sweeps, the
+ * halo exchange and the random numbers are of Metrop,
+ * only the table and the row kernel differ
+ */
+HeatBath::HeatBath(Machine* host, int init, double beta, unsigned int seed)
+	 : Metrop(host, init, beta, seed)
+{
+	setBeta(beta);
+
+	// the heat-bath kernel of the same instruction set,
+	// Metrop has checked that kernel=... is supported
+	Kernel = selectHeatKernel(host->getOption("kernel", "auto"));
+}
+
+
+/*
+ * destructor: release resources
+ */
+HeatBath::~HeatBath()
+{
+}
+
+
+/*
+ * set Beta and pre-compute the probabilities of it
+ */
+void HeatBath::setBeta(double beta)
+{
+	Beta = beta;
+	Factor = -2 * Beta;
+
+	// pre-compute the probabilities of spin up for
+	// different sums of the neighbour values:
+	// P(si = +1) = 1 / (1 + exp(-2 * Beta * sum(sj)))
+	// P(si = +1) = 1 / (1 + exp(Factor * COMBS#))
+
+	ExpoDelta[0] = 1 / (1 + exp(Factor * (double)COMBS0));
+	ExpoDelta[1] = 1 / (1 + exp(Factor * (double)COMBS1));
+	ExpoDelta[2] = 1 / (1 + exp(Factor * (double)COMBS2));
+	ExpoDelta[3] = 1 / (1 + exp(Factor * (double)COMBS3));
+	ExpoDelta[4] = 1 / (1 + exp(Factor * (double)COMBS4));
+
+	// spin up if a raw random number r <= Threshold,
+	// indexed by (sum(sj) + 4) / 2 as ExpoDelta
+	for (int i = 0; i < 5; i++)
+		Threshold[i] = acceptThreshold(ExpoDelta[i]);
+}
+
+
+/*
+ * heat-bath procces, check if the new value drawn
+ * for the site is the opposite of the current one
+ */
+bool HeatBath::isAccept(int row, int col)
+{
+	int current = (*Spins)(row, col);
+	int left    = (*Spins)(row, col - 1);
+	int right   = (*Spins)(row, col + 1);
+	int up      = (*Spins)(row - 1, col);
+	int down    = (*Spins)(row + 1, col);
+
+	int sum = left + right + up + down;
+
+	// spin up if r <= Threshold for a raw
+	// random number r ~ U[0, 2^32)
+	int spin = (Generator() <= Threshold[(sum - COMBS0) / 2]) ? 1 : -1;
+
+	return spin != current;
+}
+
+};
+
+
+/*================ End of File ================*/
@@ -0,0 +1,39 @@
+/*=====================================================
+ * HeatBath.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the class HeatBath that
+ * implements the heat-bath algorithm on the
+ * checkerboard sweeps of Metrop
+ *=====================================================*/
+
+
+#ifndef HEATBATH_H_
+#define HEATBATH_H_
+
+
+#include "Metrop.h"
+
+
+namespace wenchong
+{
+
+class HeatBath : public Metrop
+{
+public:
+	HeatBath(Machine* host, int init, double beta, unsigned int seed);
+	~HeatBath();
+
+	virtual void setBeta(double beta);
+
+private:
+	virtual bool isAccept(int row, int col);
+};
+
+};
+
+
+#endif
@@ -23,9 +23,10 @@ namespace wenchong
  */
 Machine::Machine(int argc, char* argv[])
 {
-	if (argc != 8)
+	if (argc < 8)
 	{
-		std::cout << "Usage: ./exe L L np_x np_y nMeas nSweeps nTherms\n";
+		std::cout << "Usage: ./exe L L np_x np_y nMeas nSweeps nTherms"
+				  << " [key=value ...]\n";
 		MPI_Abort(MPI_COMM_WORLD, 1);
 	}
 	
@@ -36,6 +37,7 @@ Machine::Machine(int argc, char* argv[])
 		MPI_Abort(MPI_COMM_WORLD, 1);
 	}
 
+	Argc = argc;
 	Argv = argv;
 
 	// get # of processes from command line
@@ -47,18 +49,174 @@ Machine::Machine(int argc, char* argv[])
 	nSweeps = atoi(argv[6]);
 	nThrow = atoi(argv[7]);
 
-	MPI_Comm_size(MPI_COMM_WORLD, &nProc);
-	MPI_Comm_rank(MPI_COMM_WORLD, &Rank);
+	// the same on all processes, seed=N
+	Seed = (unsigned int)strtoul(getOption("seed", "25938026"), NULL, 10);
+
+	// threads=N, by default OMP_NUM_THREADS or all cores
+	nThreads = atoi(getOption("threads", "0"));
+	if (nThreads > 0)
+		omp_set_num_threads(nThreads);
+	else
+		nThreads = omp_get_max_threads();
+
+	// batch=N, reduce the measures to ROOT N at a time
+	Batch = atoi(getOption("batch", "4096"));
+	if (Batch < 1)
+	{
+		std::cout << "Invalid batch size: " << Batch << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// inflight=R, reduce every measure to all processes
+	// with up to R reductions in flight, 0 (default)
+	// reduces them in batches to ROOT only
+	InFlight = atoi(getOption("inflight", "0"));
+	if (InFlight < 0)
+	{
+		std::cout << "Invalid # of reductions in flight: " << InFlight << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// depth=D, exchange the halos once every D sweeps
+	HaloDepth = atoi(getOption("depth", "1"));
+	if (HaloDepth < 1)
+	{
+		std::cout << "Invalid halo depth: " << HaloDepth << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// scan=b0,b1,... walks the betas in one run, each
+	// point starts from the spins of the one before
+	for (const char* c = getOption("scan", ""); *c != '\0'; )
+	{
+		char* end;
+		Scan.push_back(strtod(c, &end));
+
+		if (end == c || Scan.back() <= 0.0 || (*end != ',' && *end != '\0'))
+		{
+			std::cout << "Invalid beta in scan: " << c << "\n";
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+
+		c = (*end == ',') ? end + 1 : end;
+	}
+
+	// rethrow=N, sweeps to re-thermalize at the points
+	// after the first, by default nThrow / 10
+	nRethrow = atoi(getOption("rethrow", "-1"));
+	if (nRethrow < 0)
+		nRethrow = nThrow / 10;
+
+	// checkpoint=N, write a checkpoint every N measures
+	// to ckpfile=NAME and resume from it, 0 (default)
+	// runs without, walltime=S stops at a checkpoint
+	// before S seconds of sweeps are up
+	CheckpointInterval = atoi(getOption("checkpoint", "0"));
+	CheckpointFile = getOption("ckpfile", "ising.ckp");
+	WallTime = atof(getOption("walltime", "0"));
+	if (CheckpointInterval < 0 || WallTime < 0.0)
+	{
+		std::cout << "Invalid checkpoint interval or wall time\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	if (CheckpointInterval == 0 && WallTime > 0.0)
+		CheckpointInterval = Measures;
+
+	// snapshot=N, write the spins every N measures
+	SnapshotInterval = atoi(getOption("snapshot", "0"));
+	if (SnapshotInterval < 0)
+	{
+		std::cout << "Invalid snapshot interval: " << SnapshotInterval << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// report=N, print Tau every N measures
+	ReportInterval = atoi(getOption("report", "0"));
+
+	// betas=b0,b1,... gives a replica per beta
+	nReplicas = 1;
+	for (const char* c = getOption("betas", ""); *c != '\0'; c++)
+		nReplicas += (*c == ',');
+
+	if (nReplicas == 1 && *getOption("betas", "") != '\0')
+	{
+		std::cout << "betas=... needs at least two betas to swap\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	int worldSize, worldRank;
+	MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+	MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+
+	// a process grid per replica must cover all processes
+	if (nx * ny * nReplicas != worldSize)
+	{
+		std::cout << "Incompatible grid parallelisation: "
+				  << nReplicas << " x " << nx << " x " << ny
+				  << " on " << worldSize << " processes\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	if (nReplicas > 1 && !Scan.empty())
+	{
+		std::cout << "scan=... and betas=... cannot be combined\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	if (CheckpointInterval > 0 && (nReplicas > 1 || !Scan.empty()))
+	{
+		std::cout << "checkpoint=... cannot be combined with betas=... or scan=...\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	nProc = nx * ny;
+	Replica = worldRank / nProc;
+
+	MPI_Comm group;
+	MPI_Comm_split(MPI_COMM_WORLD, Replica, worldRank, &group);
+
+	// periodic ny x nx process grid, the MPI library may
+	// reorder the ranks to put neighbours on the same node,
+	// so Rank is the rank in Comm, not in MPI_COMM_WORLD
+	int dims[2] = {ny, nx};
+	int periods[2] = {1, 1};
+	int coords[2];
+
+	MPI_Cart_create(group, 2, dims, periods, 1, &Comm);
+	MPI_Comm_rank(Comm, &Rank);
+	MPI_Comm_free(&group);
+
+	// the same Rank of all grids, ordered by replica
+	MPI_Comm_split(MPI_COMM_WORLD, Rank, Replica, &Replicas);
 
 	// compute x, y coordinates in Machine geometry
-	x = Rank % nx;
-	y = Rank / nx;
+	MPI_Cart_coords(Comm, Rank, 2, coords);
+	y = coords[0];
+	x = coords[1];
 
 	// assign Neighbour processor id with periodic boundary
-	Neighbour[NORTH] = x + (y + 1) % ny * nx;
-	Neighbour[SOUTH] = x + (y - 1 + ny) % ny * nx;
-	Neighbour[EAST]  = (x + 1) % nx + y * nx;
-	Neighbour[WEST]  = (x - 1 + nx) % nx + y * nx;
+	MPI_Cart_shift(Comm, 0, 1, &Neighbour[SOUTH], &Neighbour[NORTH]);
+	MPI_Cart_shift(Comm, 1, 1, &Neighbour[WEST], &Neighbour[EAST]);
+}
+
+
+/*
+ * get the value of an optional argument given as
+ * key=value after the positional arguments,
+ * return defaultValue if the key is not present
+ */
+const char* Machine::getOption(const char* key, const char* defaultValue)
+{
+	size_t len = strlen(key);
+
+	for (int i = 8; i < Argc; i++)
+	{
+		if (strncmp(Argv[i], key, len) == 0 && Argv[i][len] == '=')
+			return Argv[i] + len + 1;
+	}
+
+	return defaultValue;
 }
 
 
@@ -66,7 +224,10 @@ Machine::Machine(int argc, char* argv[])
  * Destructor
  */
 Machine::~Machine()
-{}
+{
+	MPI_Comm_free(&Comm);
+	MPI_Comm_free(&Replicas);
+}
 
 };
 
@@ -18,7 +18,10 @@
 #include <stdarg.h>
 #include <sstream>
 #include <cstring>
+#include <cstdlib>
+#include <vector>
 #include "mpi.h"
+#include <omp.h>
 
 
 // neighbour types
@@ -37,8 +40,18 @@ public:
 	Machine(int argc, char* argv[]);
 	~Machine();
 
-	int nProc;         // # of total processes
-	int Rank;          // rank of process
+	// value of an optional "key=value" argument
+	const char* getOption(const char* key, const char* defaultValue);
+
+	MPI_Comm Comm;     // periodic Cartesian process grid
+	int nProc;         // # of processes in Comm
+	int Rank;          // rank of process in Comm
+
+	// betas=b0,b1,...: one process grid per beta, the
+	// replicas are numbered by their first beta
+	MPI_Comm Replicas; // the processes of this Rank in all grids
+	int nReplicas;     // # of process grids
+	int Replica;       // replica of this process
 
 	int nx;            // # of processes on x-axis
 	int ny;            // # of processes on y-axis
@@ -52,6 +65,22 @@ public:
 	int nSweeps;       // # of sweeps between two measures
 	int nThrow;        // # of sweeps for thermalization
 
+	unsigned int Seed; // global seed of the run
+	int nThreads;      // # of threads per process
+	int HaloDepth;     // # of sweeps between halo exchanges
+	int Batch;         // # of measures per reduction to ROOT
+	int InFlight;      // # of global measures in flight, or 0
+
+	std::vector<double> Scan; // scan=b0,b1,...: betas of a scan
+	int nRethrow;      // # of sweeps to re-thermalize at a point
+
+	int CheckpointInterval;     // # of measures between checkpoints, or 0
+	const char* CheckpointFile; // the last checkpoint
+	double WallTime;   // wall time budget in seconds, or 0
+	int SnapshotInterval;       // # of measures between snapshots, or 0
+	int ReportInterval;         // # of measures between Tau reports, or 0
+
+	int Argc;          // # of arguments
 	char** Argv;       // argument values
 };
 
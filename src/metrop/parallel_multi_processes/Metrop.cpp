@@ -22,6 +22,54 @@ namespace wenchong
 Metrop::Metrop(Machine* host, int init, double beta, unsigned int seed)
 	 : BaseLattice(host, init, beta, seed)
 {
+	setBeta(beta);
+
+	// kernel=auto (default), scalar, avx2 or avx512
+	const char* kernel = host->getOption("kernel", "auto");
+	Kernel = selectSweepKernel(kernel);
+	Philox = selectRandKernel(kernel);
+
+	if (Kernel == NULL || Philox == NULL)
+	{
+		std::cout << "Unsupported sweep kernel: " << kernel << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// whole groups of 64 numbers around a row,
+	// one row buffer per thread
+	nThreads = host->nThreads;
+	nRands = nCol + 2 * Spins->kGhost + 128;
+	Rands = new uint32_t[nThreads * nRands];
+	for (int j = 0; j < nThreads * nRands; j++)
+		Rands[j] = 0;
+
+	// the random numbers of the sweeps are keyed by the
+	// global seed, not the seed of this process, so that
+	// they do not depend on the decomposition, and by the
+	// replica, so that replicas of a run differ
+	Key[0] = host->Seed;
+	Key[1] = host->Replica;
+	Sweep = 0;
+}
+
+
+/*
+ * destructor: release resources
+ */
+Metrop::~Metrop()
+{
+	delete [] Rands;
+}
+
+
+/*
+ * set Beta and pre-compute the acceptance of it,
+ * the sweeps go on with the new tables
+ */
+void Metrop::setBeta(double beta)
+{
+	Beta = beta;
+
 	// pre-compute the exponetial factors for
 	// different combinations of neighbour values
 	// as defined below:
@@ -38,26 +86,58 @@ Metrop::Metrop(Machine* host, int init, double beta, unsigned int seed)
 	ExpoDelta[2] = exp(Factor * (double)COMBS2);
 	ExpoDelta[3] = exp(Factor * (double)COMBS3);
 	ExpoDelta[4] = exp(Factor * (double)COMBS4);
+
+	// accept if a raw random number r <= Threshold,
+	// indexed by ([si * sum(sj)] + 4) / 2 as ExpoDelta
+	for (int i = 0; i < 5; i++)
+		Threshold[i] = acceptThreshold(ExpoDelta[i]);
 }
 
 
 /*
- * update the local lattice with even-odd ordering
+ * update the local lattice with even-odd ordering,
+ * the boundary data of a half sweep is in flight
+ * while its interior sites are updated
  */
 void Metrop::update(int numSweeps)
 {
+	int depth = Host->HaloDepth;
+
 	for (int i = 0; i < numSweeps; i ++)
 	{
-		// update even sites and exchange boundary data
-		updateLattice(EVEN);
-		Spins->packBuffer(EVEN);
-		Comms->sendBoundaryData(Spins);
-
-		// update odd sites and exchange boundary data
-		updateLattice(ODD);
-		Spins->packBuffer(ODD);
-		Comms->sendBoundaryData(Spins);
+		// deep halo: exchange once every depth sweeps and
+		// update the ghost sites too, they get the same
+		// random numbers as on their owner process
+		if (depth > 1)
+		{
+			if (Sweep % depth == 0)
+				Comms->sendBoundaryBands(Spins);
+
+			int done = 2 * (Sweep % depth);  // half sweeps since
+			updateRegion(EVEN, done + 1);
+			updateRegion(ODD, done + 2);
+
+			Sweep++;
+			continue;
+		}
+
+		for (int flag = EVEN; flag <= ODD; flag++)
+		{
+			// the ghosts of the other parity are needed
+			// by the boundary sites only
+			Comms->waitBoundaryData();
+			updateBoundary(flag);
+
+			// the interior neither reads the ghosts of this
+			// parity nor writes the boundary being sent
+			Comms->startBoundaryData(Spins, flag);
+			updateInterior(flag);
+		}
+
+		Sweep++;
 	}
+
+	Comms->waitBoundaryData();
 }
 
 
@@ -67,19 +147,220 @@ void Metrop::update(int numSweeps)
  */
 void Metrop::updateLattice(int evenOddFlag)
 {
+	updateBoundary(evenOddFlag);
+	updateInterior(evenOddFlag);
+}
+
+
+/*
+ * update the sites of a parity next to the ghosts:
+ * the first and the last row, and the first and the
+ * last block of the other rows in the sublattice,
+ * a block of EDGE_SITES keeps the kernels aligned and
+ * its numbers are not drawn again for the interior
+ */
+void Metrop::updateBoundary(int evenOddFlag)
+{
+	int nHalf = Spins->nyHalf;
+	int head = std::min(EDGE_SITES, nHalf);
+	int tail = std::max(head, (nHalf - 1) / EDGE_SITES * EDGE_SITES);
+
+	long magnet = 0, energy = 0;
+
+	#pragma omp parallel for schedule(static) num_threads(nThreads) \
+		reduction(+:magnet, energy)
 	for (int i = 0; i < nRow; i++)
 	{
-		// decide the starting site to update
-		int start = (i + evenOddFlag) % 2;
+		uint32_t* buffer = Rands + omp_get_thread_num() * nRands;
+		long delta[2] = {0, 0};
 
-		for (int j = start; j < nCol; j += 2)
+		if (i == 0 || i == nRow - 1)
+		{
+			updateRow(i, evenOddFlag, 0, nHalf, buffer, delta);
+		}
+		else
 		{
-			// accept-reject process:
-			// if proposal is accepted, flip spin
-			if (isAccept(i, j))
-				flipSpin(i, j);
+			updateRow(i, evenOddFlag, 0, head, buffer, delta);
+			if (tail < nHalf)
+				updateRow(i, evenOddFlag, tail, nHalf, buffer, delta);
 		}
+
+		magnet += delta[0];
+		energy += delta[1];
+	}
+
+	Magnet += magnet;
+	Energy += energy;
+}
+
+
+/*
+ * update the sites of a parity not updated by
+ * updateBoundary, the rows are shared by the threads
+ * with the same static schedule as Field::init, so a
+ * thread mostly updates the rows it touched first
+ */
+void Metrop::updateInterior(int evenOddFlag)
+{
+	int nHalf = Spins->nyHalf;
+	int head = std::min(EDGE_SITES, nHalf);
+	int tail = std::max(head, (nHalf - 1) / EDGE_SITES * EDGE_SITES);
+
+	if (head == tail)
+		return;
+
+	long magnet = 0, energy = 0;
+
+	#pragma omp parallel for schedule(static) num_threads(nThreads) \
+		reduction(+:magnet, energy)
+	for (int i = 1; i < nRow - 1; i++)
+	{
+		uint32_t* buffer = Rands + omp_get_thread_num() * nRands;
+		long delta[2] = {0, 0};
+
+		updateRow(i, evenOddFlag, head, tail, buffer, delta);
+
+		magnet += delta[0];
+		energy += delta[1];
 	}
+
+	Magnet += magnet;
+	Energy += energy;
+}
+
+
+/*
+ * update the sites of a parity that are still valid
+ * after the half sweep # halfSweep since the exchange
+ * of the bands: the local lattice and the ghost layers
+ * but the outer halfSweep ones
+ */
+void Metrop::updateRegion(int evenOddFlag, int halfSweep)
+{
+	int nGhost = Spins->nGhost;
+	int margin = nGhost - halfSweep;
+
+	// cols -margin, ..., nCol+margin-1 of the row
+	int colLo = -margin;
+	int colHi = nCol + margin - 1;
+
+	long magnet = 0, energy = 0;
+
+	#pragma omp parallel for schedule(static) num_threads(nThreads) \
+		reduction(+:magnet, energy)
+	for (int i = -margin; i < nRow + margin; i++)
+	{
+		uint32_t* buffer = Rands + omp_get_thread_num() * nRands;
+		long delta[2] = {0, 0};
+		long ghost[2] = {0, 0};
+
+		// first and last col of the parity, and their k
+		int c0 = colLo + (colLo + i + evenOddFlag + 4 * nGhost) % 2;
+		int c1 = colHi - (colHi + i + evenOddFlag + 4 * nGhost) % 2;
+
+		int begin = (c0 + 2 * nGhost) / 2 - nGhost;
+		int end = (c1 + 2 * nGhost) / 2 - nGhost + 1;
+
+		// only the flips of local sites are counted
+		if (i < 0 || i >= nRow)
+		{
+			updateRow(i, evenOddFlag, begin, end, buffer, ghost);
+		}
+		else
+		{
+			updateRow(i, evenOddFlag, begin, 0, buffer, ghost);
+			updateRow(i, evenOddFlag, 0, Spins->nyHalf, buffer, delta);
+			updateRow(i, evenOddFlag, Spins->nyHalf, end, buffer, ghost);
+		}
+
+		magnet += delta[0];
+		energy += delta[1];
+	}
+
+	Magnet += magnet;
+	Energy += energy;
+}
+
+
+/*
+ * update the sites k = begin, ..., end-1 of a row in
+ * the sublattice evenOddFlag, the sites of a parity do
+ * not depend on each other, buffer is of the thread,
+ * rows and sites of a deep halo may lie beyond the
+ * global lattice and are wrapped around for the
+ * random numbers, the changes of the spin sum and
+ * the bond energy are added to delta
+ */
+void Metrop::updateRow(int row, int evenOddFlag, int begin, int end,
+					   uint32_t* buffer, long* delta)
+{
+	int stride = Spins->nyStride;
+	int nGhost = Spins->nGhost;
+
+	// decide the starting site to update
+	int start = (row + evenOddFlag + 2 * nGhost) % 2;
+
+	int* cur = Spins->Sites[evenOddFlag] + row * stride;
+	int* other = Spins->Sites[1 - evenOddFlag] + row * stride;
+
+	int nxGlobal = Spins->nxGlobal;
+	int nkGlobal = Spins->nyGlobal / 2;
+	int first = Spins->yOffset / 2;  // global k of k = 0
+
+	uint32_t globalRow = (uint32_t)((Spins->xOffset + row + nxGlobal) % nxGlobal);
+
+	// the parts of the row before, on and after the global
+	// lattice, given by the global k of their k = 0
+	int wrap[3] = {first + nkGlobal, first, first - nkGlobal};
+	int lo[3] = {begin, std::max(begin, -first), std::max(begin, nkGlobal - first)};
+	int hi[3] = {std::min(end, -first), std::min(end, nkGlobal - first), end};
+
+	for (int part = 0; part < 3; part++)
+	{
+		if (lo[part] >= hi[part])
+			continue;
+
+		// the Philox numbers depend on the site only, so
+		// the threads need no generator state of their own
+		const uint32_t* rands = fillRands(globalRow, evenOddFlag, wrap[part],
+										  lo[part], hi[part], buffer);
+
+		// site k of the row in the sublattice has its
+		// left and right neighbours at k+start-1 and k+start
+		// of the other sublattice, the boundary sites read
+		// the ghost cells the same way
+		Kernel(cur, other + start - 1, other + start, other - stride, other + stride,
+			   lo[part], hi[part], Threshold, rands, delta);
+	}
+}
+
+
+/*
+ * fill buffer with the random numbers of the sites
+ * k = begin, ..., end-1 of a row in the sublattice
+ * evenOddFlag whose k = 0 has the global k first,
+ * and return the number of k = 0,
+ * the number of a site with global k is output
+ * (global k % 64) / 16 of Philox with the counter
+ * (global k / 64 * 16 + global k % 16, global row,
+ * Sweep, parity), so it is the same on any process
+ * that holds the site, and 16 sites are served
+ * by one vector of counters
+ */
+const uint32_t* Metrop::fillRands(uint32_t globalRow, int evenOddFlag, int first,
+								  int begin, int end, uint32_t* buffer)
+{
+	// buffer[0] is the first number of the group of
+	// k = -kGhost, only the groups of k = begin, ..., end-1
+	// are filled
+	int low = first - Spins->kGhost;
+	int group0 = (low >= 0) ? low / 64 : -((63 - low) / 64);
+
+	for (int group = (first + begin) / 64; group * 64 < first + end; group++)
+		Philox((uint32_t)group, globalRow, (uint32_t)Sweep,
+			   (uint32_t)evenOddFlag, Key, buffer + (group - group0) * 64);
+
+	return buffer + (first - group0 * 64);
 }
 
 
@@ -103,48 +384,16 @@ bool Metrop::isAccept(int row, int col)
 	// delta = Factor * COMBS#
 
 	// e^delta = exp(delta), which is computed
-	// at construction as ExpoDelta,
-	// so compute the combination value of [si * sum(sj)]
-	// below, and check which case the ExpoDelta should
-	// be applied
+	// at construction as ExpoDelta and its
+	// 32-bit Threshold, indexed by the
+	// combination value of [si * sum(sj)]
 
 	int comb = current * (left + right + up + down);
-	double expo = 0.0;
 
-	switch (comb)
-	{
-		case COMBS0:
-			expo = ExpoDelta[0];
-			break;
-		case COMBS1:
-			expo = ExpoDelta[1];
-			break;
-		case COMBS2:
-			expo = ExpoDelta[2];
-			break;
-		case COMBS3:
-			expo = ExpoDelta[3];
-			break;
-		case COMBS4:
-			expo = ExpoDelta[4];
-			break;
-		default:
-			break;
-	}
-
-	/*===== condition 1: exp >= 1 --> accept =====*/
-	if (expo >= 1.0)
-	{
-		return true;
-	}
-
-	/*========== condition 2: exp < 1 ==========*/
-	// - if u ~ U(0, 1) < exp --> accept
-	// - otherwise --> don't accept
-	//double u = (double)rand() / RAND_MAX;
-	double u = UniformDist(Generator);
-
-	if ((u - expo) < 0.0)
+	// accept if r <= Threshold for a raw
+	// random number r ~ U[0, 2^32), which is
+	// always true if exp >= 1
+	if (Generator() <= Threshold[(comb - COMBS0) / 2])
 	{
 		return true;
 	}
@@ -154,65 +403,20 @@ bool Metrop::isAccept(int row, int col)
 
 
 /*
- * compute susceptibility X=<m^2>
+ * the Philox counter, # of sweeps
  */
-void Metrop::computeXt(void)
+unsigned int Metrop::getCounter(void)
 {
-	int max = Measures * nSweeps;  // number of total sweeps
-	double average = 0.0; // average spin in a sweep at time(meas) t
-	std::ofstream ofsXt;
-
-	// only write output to file inside one process
-	if (Spins->Host->Rank == ROOT)
-	{
-		char* filenameXt = (char*)"xt.dat";
-		ofsXt.open(filenameXt, std::ofstream::out);
-
-		if (!ofsXt.is_open())
-			throw std::invalid_argument("Metrop::(): Error opening file xt.dat!");
-	}
-	
-	// number of total sites of the global lattice
-	double nGlobalSites = (double)(Spins->nxGlobal * Spins->nyGlobal);
-
-	// comuting X=<m^2>
-	for (int i = 0; i < max; i++)
-	{
-		update(1);
-		
-		// sum up the spins at time t at every nSweeps
-		if ((i % nSweeps) == 0)
-		{
-			double localSum = (double)sumSpins();
-			double globalSum = 0.0;
-
-			// get global sum over spins
-			Comms->computeGlobalSum(&localSum, &globalSum);
-
-			// computing magnetization
-			average = globalSum / nGlobalSites;
-
-			// computing X = magnetization ^ 2
-			average *= average;
+	return Sweep;
+}
 
-			// store X for Rho and Tau evaluation
-			Xt.push_back(average);
 
-			// calculate Mean and Variance of X
-			Mean += average;
-			Var += average * average;
-			
-			// store X in file
-			if (Spins->Host->Rank == ROOT)
-				ofsXt << average << std::endl;	
-		}
-	}
-	
-	if (Spins->Host->Rank == ROOT)
-		ofsXt.close();
-	
-	Mean /= (double)Measures;
-	Var = Var / (double)Measures - Mean * Mean;
+/*
+ * restore the Philox counter of a checkpoint
+ */
+void Metrop::setCounter(unsigned int counter)
+{
+	Sweep = counter;
 }
 
 };
@@ -14,7 +14,12 @@
 #define METROP_H_
 
 
+#include <algorithm>
+
 #include "BaseLattice.h"
+#include "Acceptance.h"
+#include "Philox.h"
+#include "SweepKernel.h"
 
 
 // valuses of combinations of [si * sum(sj)]
@@ -25,6 +30,9 @@
 #define COMBS3  2
 #define COMBS4  4
 
+// sites of a boundary block, one Philox group
+#define EDGE_SITES 64
+
 
 namespace wenchong
 {
@@ -33,15 +41,32 @@ class Metrop : public BaseLattice
 {
 public:
 	Metrop(Machine* host, int init, double beta, unsigned int seed);
-	~Metrop() {}
+	~Metrop();
 	
 	virtual void update(int numSweeps);
-	virtual void computeXt(void);
+	virtual void setBeta(double beta);
 
-private:
+protected:
 	double ExpoDelta[5];  // to store pre-computed factors
+	uint32_t Threshold[5]; // ExpoDelta as 32-bit thresholds
+	uint32_t* Rands;      // raw random numbers of a row per thread
+	int nRands;           // size of the row buffer of a thread
+	int nThreads;         // # of threads sharing the rows
+	uint32_t Key[2];      // Philox key: global seed, stream
+	unsigned int Sweep;   // # of sweeps done, Philox counter
+	SweepKernel Kernel;   // row kernel of the half sweep
+	RandKernel Philox;    // Philox kernel matching Kernel
+	const uint32_t* fillRands(uint32_t globalRow, int evenOddFlag, int first,
+							  int begin, int end, uint32_t* buffer);
+	void updateRow(int row, int evenOddFlag, int begin, int end,
+				   uint32_t* buffer, long* delta);
+	void updateBoundary(int evenOddFlag);
+	void updateInterior(int evenOddFlag);
+	void updateRegion(int evenOddFlag, int halfSweep);
 	virtual void updateLattice(int evenOddFlag);
 	virtual bool isAccept(int row, int col);
+	virtual unsigned int getCounter(void);
+	virtual void setCounter(unsigned int counter);
 };
 
 };
@@ -0,0 +1,252 @@
+/*=====================================================
+ * MultiReplica.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class
+ * MultiReplica, the 64 replicas of a site are tested
+ * and flipped at once with the bitwise logic of
+ * MultiSpin, each by its own random bits, which come
+ * from Philox a batch at a time
+ *=====================================================*/
+
+
+#include "MultiReplica.h"
+
+
+namespace wenchong
+{
+
+/*
+ * construct 64 replicas of the 2D lattice system,
+ * all starting from init, the measures of tempering
+ * and of inflight=R would sum over all replicas
+ */
+MultiReplica::MultiReplica(Machine* host, int init, double beta, unsigned int seed)
+	: MultiSpin(host, init, beta, seed, true)
+{
+	if (host->nReplicas > 1 || host->InFlight > 0)
+	{
+		std::cout << "algo=multireplica cannot be combined with betas=... or inflight=...\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// kernel=auto (default), scalar, avx2 or avx512
+	const char* kernel = host->getOption("kernel", "auto");
+	Philox = selectRandKernel(kernel);
+
+	if (Philox == NULL)
+	{
+		std::cout << "Unsupported sweep kernel: " << kernel << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// the random words of a half sweep are keyed as in
+	// Metrop, and counted by (group, rank, sweep, parity)
+	Key[0] = host->Seed;
+	Key[1] = host->Replica;
+	Sweep = 0;
+	Parity = EVEN;
+	Group = 0;
+}
+
+
+/*
+ * destructor: release resources
+ */
+MultiReplica::~MultiReplica()
+{
+}
+
+
+/*
+ * draw RAND_WORDS random words of the half sweep,
+ * 32 words of a Philox group at a time
+ */
+void MultiReplica::fillRands(void)
+{
+	uint32_t out[64];
+
+	for (int j = 0; j < RAND_WORDS; j += 32)
+	{
+		Philox(Group++, (uint32_t)Host->Rank, (uint32_t)Sweep, (uint32_t)Parity, Key, out);
+
+		for (int m = 0; m < 32; m++)
+			Rands[j + m] = out[2 * m] | ((uint64_t)out[2 * m + 1] << 32);
+	}
+
+	nRands = 0;
+}
+
+
+/*
+ * a half sweep of even sites or odd sites of all
+ * replicas, the neighbours of a site are whole words
+ * of the same replicas, the sites of the half sweep
+ * are contiguous in Planes[evenOddFlag]
+ */
+void MultiReplica::updateLattice(int evenOddFlag)
+{
+	int nHalf = Words->nHalf;
+	uint64_t* north = Words->RecvBuffer[NORTH];
+	uint64_t* south = Words->RecvBuffer[SOUTH];
+	const uint64_t all = ~(uint64_t)0;
+
+	// a new stream of random words
+	Parity = evenOddFlag;
+	Group = 0;
+	nRands = RAND_WORDS;
+
+	for (int i = 0; i < nRow; i++)
+	{
+		// site k of the row has its left and right
+		// neighbours at k + start - 1 and k + start
+		// of the row in the other parity
+		uint64_t* cur = Words->Planes[evenOddFlag] + i * nHalf;
+		uint64_t* other = Words->Planes[1 - evenOddFlag] + i * nHalf;
+		int start = (i + evenOddFlag) & 1;
+
+		// rows above and below, may be the boundary data,
+		// which holds the other parity after nHalf words
+		uint64_t* up   = (i == 0) ? Words->RecvBuffer[WEST] + (1 - evenOddFlag) * nHalf
+								  : other - nHalf;
+		uint64_t* down = (i == nRow - 1) ? Words->RecvBuffer[EAST] + (1 - evenOddFlag) * nHalf
+										 : other + nHalf;
+
+		// the first site of the row is at col 0
+		if (start == 0)
+			cur[0] ^= flipMask(cur[0], south[i], other[0], up[0], down[0], all);
+
+		for (int k = 1 - start; k < nHalf - start; k++)
+			cur[k] ^= flipMask(cur[k], other[k + start - 1], other[k + start],
+							   up[k], down[k], all);
+
+		// the last site of the row is at col nCol - 1
+		if (start == 1)
+			cur[nHalf - 1] ^= flipMask(cur[nHalf - 1], other[nHalf - 1], north[i],
+									   up[nHalf - 1], down[nHalf - 1], all);
+	}
+
+	// a sweep ends with the odd sites
+	if (evenOddFlag == ODD)
+		Sweep++;
+}
+
+
+/*
+ * compute susceptibility X=<m^2> averaged over the
+ * replicas, the magnetization of every replica goes
+ * to mt.bin, a row per measure,
+ * the measures are reduced to ROOT Batch at a time
+ */
+void MultiReplica::computeXt(void)
+{
+	int max = Measures * nSweeps;  // number of total sweeps
+	TimeSeries seriesXt;
+	TimeSeries seriesEt;
+	TimeSeries seriesMt;
+
+	// only write output to file inside one process
+	if (Host->Rank == ROOT)
+	{
+		seriesXt.open(outputName("xt", ".bin"), seriesHeader("xt", 1), 0);
+		seriesEt.open(outputName("et", ".bin"), seriesHeader("et", 1), 0);
+		seriesMt.open(outputName("mt", ".bin"), seriesHeader("mt", WORD_BITS), 0);
+	}
+
+	// the spin sums of the replicas, then their bond
+	// sums, 2 * 64 values per measure
+	std::vector<double> localSums;
+	localSums.reserve(2 * WORD_BITS * std::min(Host->Batch, Measures));
+
+	long spins[WORD_BITS], bonds[WORD_BITS];
+
+	for (int i = 0; i < max; i++)
+	{
+		update(1);
+
+		if ((i % nSweeps) != 0)
+			continue;
+
+		Words->sumReplicas(spins, bonds);
+
+		for (int k = 0; k < WORD_BITS; k++)
+			localSums.push_back((double)spins[k]);
+
+		for (int k = 0; k < WORD_BITS; k++)
+			localSums.push_back((double)bonds[k]);
+
+		if ((int)localSums.size() == 2 * WORD_BITS * Host->Batch)
+			reduceReplicas(localSums, seriesXt, seriesEt, seriesMt);
+	}
+
+	reduceReplicas(localSums, seriesXt, seriesEt, seriesMt);
+
+	if (Host->Rank == ROOT)
+	{
+		seriesXt.close();
+		seriesEt.close();
+		seriesMt.close();
+
+		Mean = Acf.mean();
+		Var = Acf.variance();
+	}
+}
+
+
+/*
+ * reduce the kept measures to ROOT, which stores X
+ * and the energy per site averaged over the replicas,
+ * and the magnetization of every replica
+ */
+void MultiReplica::reduceReplicas(std::vector<double>& localSums, TimeSeries& seriesXt,
+								  TimeSeries& seriesEt, TimeSeries& seriesMt)
+{
+	int count = (int)localSums.size();
+
+	if (count == 0)
+		return;
+
+	std::vector<double> globalSums(count, 0.0);
+
+	// get global sums over spins and bonds
+	Comms->reduceToRoot(localSums.data(), globalSums.data(), count);
+	localSums.clear();
+
+	if (Host->Rank != ROOT)
+		return;
+
+	// number of total sites of the global lattice
+	double nGlobalSites = (double)Size * (double)Host->nProc;
+
+	for (int j = 0; j < count; j += 2 * WORD_BITS)
+	{
+		double average = 0.0, energy = 0.0;
+
+		for (int k = 0; k < WORD_BITS; k++)
+		{
+			double magnet = globalSums[j + k] / nGlobalSites;
+
+			average += magnet * magnet;
+			energy -= globalSums[j + WORD_BITS + k];
+
+			seriesMt.append(magnet);
+		}
+
+		average /= WORD_BITS;
+		energy /= WORD_BITS * nGlobalSites;
+
+		// X for Rho and Tau evaluation
+		addMeasure(average);
+
+		seriesXt.append(average);
+		seriesEt.append(energy);
+	}
+}
+
+};
+
+
+/*================ End of File ================*/
@@ -0,0 +1,51 @@
+/*=====================================================
+ * MultiReplica.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the class MultiReplica
+ * that implements the multi-spin coded Metropolis
+ * algorithm on 64 independent replicas, bit k of a
+ * word is the spin of replica k at a site
+ *=====================================================*/
+
+
+#ifndef MULTIREPLICA_H_
+#define MULTIREPLICA_H_
+
+
+#include "MultiSpin.h"
+#include "Philox.h"
+#include "SweepKernel.h"
+
+
+namespace wenchong
+{
+
+class MultiReplica : public MultiSpin
+{
+public:
+	MultiReplica(Machine* host, int init, double beta, unsigned int seed);
+	~MultiReplica();
+
+	virtual void computeXt(void);
+
+private:
+	uint32_t Key[2];      // Philox key: global seed, stream
+	unsigned int Sweep;   // # of sweeps done, Philox counter
+	int Parity;           // sites of the half sweep
+	uint32_t Group;       // next Philox group of the half sweep
+	RandKernel Philox;    // Philox kernel of kernel=...
+
+	virtual void fillRands(void);
+	virtual void updateLattice(int evenOddFlag);
+	void reduceReplicas(std::vector<double>& localSums, TimeSeries& seriesXt,
+						TimeSeries& seriesEt, TimeSeries& seriesMt);
+};
+
+};
+
+
+#endif
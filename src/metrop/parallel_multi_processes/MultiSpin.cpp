@@ -0,0 +1,298 @@
+/*=====================================================
+ * MultiSpin.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class MultiSpin
+ * that implements the multi-spin coded Metropolis
+ * algorithm on bit-packed spins
+ *=====================================================*/
+
+
+#include "MultiSpin.h"
+
+
+namespace wenchong
+{
+
+/*
+ * construct the bit-packed 2D lattice system
+ */
+MultiSpin::MultiSpin(Machine* host, int init, double beta, unsigned int seed)
+	: BaseLattice(host, beta, seed),
+	  Generator64(seed),
+	  nRands(RAND_WORDS)
+{
+	initWords(init, false);
+	setBeta(beta);
+}
+
+
+/*
+ * construct the lattice system with the packed layout
+ * of replicas, for subclasses
+ */
+MultiSpin::MultiSpin(Machine* host, int init, double beta, unsigned int seed,
+					 bool replicas)
+	: BaseLattice(host, beta, seed),
+	  Generator64(seed),
+	  nRands(RAND_WORDS)
+{
+	initWords(init, replicas);
+	setBeta(beta);
+}
+
+
+/*
+ * allocate and init the packed spins
+ */
+void MultiSpin::initWords(int init, bool replicas)
+{
+	if (init != 1 && init != -1)
+		throw std::invalid_argument("MultiSpin::(): invalid initial spin");
+
+	Words = new PackedField(Host, replicas);
+	Words->init(init);
+
+	Size = Words->nData;   // nRow * nCol
+	nRow = Words->nxLocal;
+	nCol = Words->nyLocal;
+}
+
+
+/*
+ * set Beta and pre-compute the acceptance of it
+ */
+void MultiSpin::setBeta(double beta)
+{
+	Beta = beta;
+
+	// with k anti-parallel neighbours, [si * sum(sj)] = 4 - 2k,
+	// so the acceptance is 1 for k >= 2, exp(-4 * Beta) for
+	// k = 1 and exp(-8 * Beta) = exp(-4 * Beta)^2 for k = 0,
+	// only exp(-4 * Beta) is needed as a 32-bit threshold
+	Factor = -2 * Beta;
+	Threshold = acceptThreshold(exp(Factor * (double)2));
+}
+
+
+/*
+ * destructor: release resources
+ */
+MultiSpin::~MultiSpin()
+{
+	delete Words;
+}
+
+
+/*
+ * update the local lattice with even-odd ordering
+ */
+void MultiSpin::update(int numSweeps)
+{
+	for (int i = 0; i < numSweeps; i++)
+	{
+		// update even sites and exchange boundary data
+		updateLattice(EVEN);
+		Words->packBuffer();
+		Comms->sendBoundaryData(Words);
+
+		// update odd sites and exchange boundary data
+		updateLattice(ODD);
+		Words->packBuffer();
+		Comms->sendBoundaryData(Words);
+	}
+}
+
+
+/*
+ * draw RAND_WORDS random words of Generator64, in the
+ * order of single draws
+ */
+void MultiSpin::fillRands(void)
+{
+	for (int j = 0; j < RAND_WORDS; j++)
+		Rands[j] = Generator64();
+
+	nRands = 0;
+}
+
+
+/*
+ * the next random word, Rands are drawn when used up
+ */
+inline uint64_t MultiSpin::nextRand(void)
+{
+	if (nRands == RAND_WORDS)
+		fillRands();
+
+	return Rands[nRands++];
+}
+
+
+/*
+ * generate a word whose bits in lanes are independently
+ * set with probability (Threshold + 1) / 2^32, by comparing
+ * 64 random numbers r ~ U[0, 2^32) with r <= Threshold
+ * bit by bit from the most significant bit,
+ * bits outside lanes are zero
+ */
+uint64_t MultiSpin::randMask(uint64_t lanes)
+{
+	uint64_t accept = 0;
+	uint64_t undecided = lanes;
+
+	for (int bit = 31; bit >= 0 && undecided != 0; bit--)
+	{
+		uint64_t r = nextRand();
+
+		// threshold bit 1: r bit 0 --> r < threshold
+		// threshold bit 0: r bit 1 --> r > threshold
+		if ((Threshold >> bit) & 1)
+		{
+			accept |= undecided & ~r;
+			undecided &= r;
+		}
+		else
+		{
+			undecided &= ~r;
+		}
+	}
+
+	// r == threshold
+	return accept | undecided;
+}
+
+
+/*
+ * a half sweep of even sites or odd sites,
+ * 64 sites are tested and flipped with bitwise
+ * logic, a half sweep of each is a whole sweep
+ */
+void MultiSpin::updateLattice(int evenOddFlag)
+{
+	int nWords = Words->nWords;
+	uint64_t* north = Words->RecvBuffer[NORTH];
+	uint64_t* south = Words->RecvBuffer[SOUTH];
+
+	for (int i = 0; i < nRow; i++)
+	{
+		uint64_t* row = Words->Data + i * nWords;
+
+		// rows above and below, may be the boundary data
+		uint64_t* up   = (i == 0) ? Words->RecvBuffer[WEST] : row - nWords;
+		uint64_t* down = (i == nRow - 1) ? Words->RecvBuffer[EAST] : row + nWords;
+
+		// boundary spins left of col 0 and right of col nCol-1
+		uint64_t leftEdge  = (south[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+		uint64_t rightEdge = (north[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+
+		// sites to update in this row
+		uint64_t sites = ((i + evenOddFlag) % 2 == 0) ? EVEN_BITS : ODD_BITS;
+
+		for (int w = 0; w < nWords; w++)
+		{
+			uint64_t current = row[w];
+
+			// shift the row by one site to line up the
+			// left and right neighbours with the current spins
+			uint64_t carryLeft  = (w == 0) ? leftEdge : row[w - 1] >> (WORD_BITS - 1);
+			uint64_t carryRight = (w == nWords - 1) ? rightEdge : row[w + 1] & 1;
+
+			uint64_t left  = (current << 1) | carryLeft;
+			uint64_t right = (current >> 1) | (carryRight << (WORD_BITS - 1));
+
+			row[w] = current ^ flipMask(current, left, right, up[w], down[w], sites);
+		}
+	}
+}
+
+
+/*
+ * the bits of sites to flip by the Metropolis test,
+ * the bits of the words are independent sites,
+ * the neighbours of a bit are the same bit of
+ * left, right, up and down
+ */
+uint64_t MultiSpin::flipMask(uint64_t current, uint64_t left, uint64_t right,
+							 uint64_t up, uint64_t down, uint64_t sites)
+{
+	// bit is set if the neighbour is anti-parallel
+	uint64_t a1 = current ^ left;
+	uint64_t a2 = current ^ right;
+	uint64_t a3 = current ^ up;
+	uint64_t a4 = current ^ down;
+
+	// count the anti-parallel neighbours k bitwise:
+	// k >= 2 --> accept, k == 1 and k == 0 --> test
+	uint64_t atLeast2 = (a1 & a2) | (a3 & a4) | ((a1 ^ a2) & (a3 ^ a4));
+	uint64_t none     = ~(a1 | a2 | a3 | a4);
+	uint64_t one      = ~(atLeast2 | none);
+
+	uint64_t flip = atLeast2;
+
+	// accept k == 1 with exp(-4 * Beta), and
+	// k == 0 with exp(-4 * Beta)^2 by two masks
+	uint64_t test = (one | none) & sites;
+	if (test != 0)
+	{
+		uint64_t mask = randMask(test);
+		flip |= one & mask;
+
+		if ((none & mask) != 0)
+			flip |= none & mask & randMask(none & mask);
+	}
+
+	return flip & sites;
+}
+
+
+/*
+ * DO NOT use this function,
+ * the accept-reject process is word-wide in updateLattice
+ */
+bool MultiSpin::isAccept(int /*row*/, int /*col*/)
+{
+	return false;
+}
+
+
+/*
+ * sum up all values of spin in the lattice
+ */
+long MultiSpin::sumSpins(void)
+{
+	return Words->sumData();
+}
+
+
+/*
+ * bond energy -sum(si * sj) of the lattice
+ */
+long MultiSpin::bondEnergy(void)
+{
+	return -Words->sumBonds();
+}
+
+
+/*
+ * print the spins of the packed lattice matrix
+ * for testing purpose
+ */
+void MultiSpin::printLattice(void)
+{
+	for (int i = 0; i < nRow; i++)
+	{
+		for (int j = 0; j < nCol; j++)
+			printf("%2d ", (*Words)(i, j));
+
+		printf("\n");
+	}
+}
+
+};
+
+
+/*================ End of File ================*/
@@ -0,0 +1,74 @@
+/*=====================================================
+ * MultiSpin.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the class MultiSpin that
+ * implements the multi-spin coded Metropolis algorithm
+ *=====================================================*/
+
+
+#ifndef MULTISPIN_H_
+#define MULTISPIN_H_
+
+
+#include <stdint.h>
+
+#include "BaseLattice.h"
+#include "Acceptance.h"
+#include "PackedField.h"
+
+
+// bits of the even/odd sites in a packed row
+// whose row index is even
+#define EVEN_BITS 0x5555555555555555ULL
+#define ODD_BITS  0xAAAAAAAAAAAAAAAAULL
+
+// # of random words drawn at a time
+#define RAND_WORDS 256
+
+
+namespace wenchong
+{
+
+class MultiSpin : public BaseLattice
+{
+public:
+	MultiSpin(Machine* host, int init, double beta, unsigned int seed);
+	~MultiSpin();
+
+	virtual void update(int numSweeps);
+	virtual void setBeta(double beta);
+	virtual void printLattice(void);
+
+protected:
+	// bit k of a word is replica k of a site
+	MultiSpin(Machine* host, int init, double beta, unsigned int seed,
+			  bool replicas);
+
+	uint32_t Threshold;  // exp(-4 * Beta) as 32-bit threshold
+	std::mt19937_64 Generator64; // 64 random bits per draw
+
+	uint64_t Rands[RAND_WORDS]; // random words drawn at a time
+	int nRands;                 // # of words of Rands used
+
+	PackedField* Words;  // the bit-packed spin matrix
+
+	void initWords(int init, bool replicas);
+	virtual void fillRands(void);
+	uint64_t nextRand(void);
+	uint64_t randMask(uint64_t lanes);
+	uint64_t flipMask(uint64_t current, uint64_t left, uint64_t right,
+					  uint64_t up, uint64_t down, uint64_t sites);
+	virtual void updateLattice(int evenOddFlag);
+	virtual bool isAccept(int row, int col);
+	virtual long sumSpins(void);
+	virtual long bondEnergy(void);
+};
+
+};
+
+
+#endif
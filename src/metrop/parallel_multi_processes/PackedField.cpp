@@ -0,0 +1,414 @@
+/*=====================================================
+ * PackedField.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class PackedField
+ * for bit-packed local lattice storage
+ *=====================================================*/
+
+
+#include "PackedField.h"
+
+
+namespace wenchong
+{
+
+/*
+ * alloc resources to PackedField
+ */
+PackedField::PackedField(Machine* m, bool replicas)
+{
+	Host = m;
+	Replicas = replicas;
+
+	// get # of points on x, y axises
+	nxGlobal = atoi(Host->Argv[1]);
+	nyGlobal = atoi(Host->Argv[2]);
+
+	// compute nxLocal, nyLocal and nWords
+	checkGrid();
+
+	// active Data size
+	nData = nxLocal * nyLocal;
+
+	Data = new uint64_t[nxLocal * nWords];
+
+	// replicas: the EVEN sites, then the ODD sites
+	Planes[EVEN] = Data;
+	Planes[ODD] = Data + nxLocal * nHalf;
+
+	// North/South boundaries hold one bit per row,
+	// or a word per row for replicas,
+	// East/West boundaries hold a whole packed row
+	nxBuffer = Replicas ? nxLocal : (nxLocal + WORD_BITS - 1) / WORD_BITS;
+	nyBuffer = nWords;
+
+	SendBuffer[NORTH] = new uint64_t[nxBuffer];
+	SendBuffer[SOUTH] = new uint64_t[nxBuffer];
+	SendBuffer[EAST]  = new uint64_t[nyBuffer];
+	SendBuffer[WEST]  = new uint64_t[nyBuffer];
+
+	RecvBuffer[NORTH] = new uint64_t[nxBuffer];
+	RecvBuffer[SOUTH] = new uint64_t[nxBuffer];
+	RecvBuffer[EAST]  = new uint64_t[nyBuffer];
+	RecvBuffer[WEST]  = new uint64_t[nyBuffer];
+}
+
+
+/*
+ * release resources allocated to PackedField
+ */
+PackedField::~PackedField()
+{
+	delete [] Data;
+
+	for (int i = 0; i < 4; i++)
+	{
+		delete [] SendBuffer[i];
+		delete [] RecvBuffer[i];
+	}
+}
+
+
+/*
+ * init data and boundary data
+ */
+void PackedField::init(int initVal)
+{
+	uint64_t word = (initVal > 0) ? ~(uint64_t)0 : 0;
+
+	// init lattice data
+	for (int i = 0; i < nxLocal * nWords; i++)
+		Data[i] = word;
+
+	// init boundary data/receive buffer
+	for (int i = 0; i < nxBuffer; i++)
+	{
+		RecvBuffer[NORTH][i] = word;
+		RecvBuffer[SOUTH][i] = word;
+	}
+
+	for (int i = 0; i < nyBuffer; i++)
+	{
+		RecvBuffer[EAST][i] = word;
+		RecvBuffer[WEST][i] = word;
+	}
+}
+
+
+/*
+ * get the value of spin at given local (row, col),
+ * of replica 0 for replicas
+ */
+int PackedField::operator() (int row, int col)
+{
+	if (row >= nxLocal || row < 0 || col >= nyLocal || col < 0)
+	{
+		throw std::out_of_range("PackedField::(): row and col our of bounds");
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	if (Replicas)
+		return (Planes[(row + col) & 1][row * nHalf + col / 2] & 1) ? 1 : -1;
+
+	uint64_t word = Data[row * nWords + col / WORD_BITS];
+
+	return ((word >> (col % WORD_BITS)) & 1) ? 1 : -1;
+}
+
+
+/*
+ * sum up all values of spin in the lattice,
+ * sum = #up - #down = 2 * popcount - # of spins,
+ * of all replicas for replicas
+ */
+long PackedField::sumData(void)
+{
+	long nUp = 0;
+	long nSpins = Replicas ? (long)WORD_BITS * nData : nData;
+
+	for (int i = 0; i < nxLocal * nWords; i++)
+		nUp += __builtin_popcountll(Data[i]);
+
+	return 2 * nUp - nSpins;
+}
+
+
+/*
+ * sum si * sj over the bonds of the local sites to
+ * their right and lower neighbours, from the counts
+ * of anti-parallel pairs, the boundary data must be
+ * up to date
+ */
+long PackedField::sumBonds(void)
+{
+	long nAnti = 0;
+
+	if (Replicas)
+	{
+		long spins[WORD_BITS], bonds[WORD_BITS];
+		long sum = 0;
+
+		sumReplicas(spins, bonds);
+
+		for (int k = 0; k < WORD_BITS; k++)
+			sum += bonds[k];
+
+		return sum;
+	}
+
+	for (int i = 0; i < nxLocal; i++)
+	{
+		uint64_t* row = Data + i * nWords;
+		uint64_t* down = (i == nxLocal - 1) ? RecvBuffer[EAST] : row + nWords;
+		uint64_t rightEdge = (RecvBuffer[NORTH][i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+
+		for (int w = 0; w < nWords; w++)
+		{
+			uint64_t carry = (w == nWords - 1) ? rightEdge : row[w + 1] & 1;
+			uint64_t right = (row[w] >> 1) | (carry << (WORD_BITS - 1));
+
+			nAnti += __builtin_popcountll(row[w] ^ right);
+			nAnti += __builtin_popcountll(row[w] ^ down[w]);
+		}
+	}
+
+	return 2 * (long)nData - 2 * nAnti;
+}
+
+
+/*
+ * pack boundary data into the send buffers,
+ * both sublattices are sent since a packed
+ * word holds even and odd sites
+ */
+void PackedField::packBuffer(void)
+{
+	if (Replicas)
+	{
+		packReplicas();
+		return;
+	}
+
+	int last = (nxLocal - 1) * nWords;
+
+	// pack first row to West buffer and
+	// last row to East buffer
+	for (int w = 0; w < nWords; w++)
+	{
+		SendBuffer[WEST][w] = Data[w];
+		SendBuffer[EAST][w] = Data[last + w];
+	}
+
+	for (int i = 0; i < nxBuffer; i++)
+	{
+		SendBuffer[SOUTH][i] = 0;
+		SendBuffer[NORTH][i] = 0;
+	}
+
+	// pack first column to South buffer and
+	// last column to North buffer, one bit per row
+	for (int x = 0; x < nxLocal; x++)
+	{
+		uint64_t south = Data[x * nWords] & 1;
+		uint64_t north = Data[x * nWords + nWords - 1] >> (WORD_BITS - 1);
+
+		SendBuffer[SOUTH][x / WORD_BITS] |= south << (x % WORD_BITS);
+		SendBuffer[NORTH][x / WORD_BITS] |= north << (x % WORD_BITS);
+	}
+}
+
+
+/*
+ * pack the boundary data of replicas, the first and
+ * the last row parity by parity, and the first and
+ * the last column, a word per row
+ */
+void PackedField::packReplicas(void)
+{
+	int last = (nxLocal - 1) * nHalf;
+
+	for (int p = 0; p < 2; p++)
+	{
+		for (int k = 0; k < nHalf; k++)
+		{
+			SendBuffer[WEST][p * nHalf + k] = Planes[p][k];
+			SendBuffer[EAST][p * nHalf + k] = Planes[p][last + k];
+		}
+	}
+
+	// site (x, 0) has parity x, site (x, nyLocal - 1)
+	// the other one, as nyLocal is even
+	for (int x = 0; x < nxLocal; x++)
+	{
+		SendBuffer[SOUTH][x] = Planes[x & 1][x * nHalf];
+		SendBuffer[NORTH][x] = Planes[(x + 1) & 1][x * nHalf + nHalf - 1];
+	}
+}
+
+
+/*
+ * add a word to the bit-sliced counters: bit k of
+ * slices[b] is bit b of the count of replica k
+ */
+static inline void addSlices(uint64_t* slices, uint64_t word)
+{
+	for (int b = 0; word != 0; b++)
+	{
+		uint64_t carry = slices[b] & word;
+		slices[b] ^= word;
+		word = carry;
+	}
+}
+
+
+/*
+ * add the bit-sliced counters to counts[k] of every
+ * replica k and clear them
+ */
+static inline void flushSlices(uint64_t* slices, int nSlices, long* counts)
+{
+	for (int b = 0; b < nSlices; b++)
+	{
+		for (int k = 0; k < WORD_BITS; k++)
+			counts[k] += (long)((slices[b] >> k) & 1) << b;
+
+		slices[b] = 0;
+	}
+}
+
+
+/*
+ * with the layout of replicas, the sum of the spins
+ * spins[k] and of si * sj over the bonds of the sites
+ * to their right and lower neighbours bonds[k] of every
+ * replica k, the words are counted bit-sliced, 64
+ * replicas at once, the boundary data must be up to date
+ */
+void PackedField::sumReplicas(long* spins, long* bonds)
+{
+	// up to 2^32 - 1 words, more than twice the
+	// sites of a process
+	const int nSlices = 32;
+	uint64_t up[nSlices], anti[nSlices];
+	long nUp[WORD_BITS], nAnti[WORD_BITS];
+
+	for (int b = 0; b < nSlices; b++)
+	{
+		up[b] = 0;
+		anti[b] = 0;
+	}
+
+	for (int k = 0; k < WORD_BITS; k++)
+	{
+		nUp[k] = 0;
+		nAnti[k] = 0;
+	}
+
+	for (int p = 0; p < 2; p++)
+	{
+		for (int i = 0; i < nxLocal; i++)
+		{
+			// site k of the row in parity p has its right
+			// neighbour at k + start of the other parity,
+			// and the one below at k of the next row
+			uint64_t* cur = Planes[p] + i * nHalf;
+			uint64_t* other = Planes[1 - p] + i * nHalf;
+			uint64_t* down = (i == nxLocal - 1) ? RecvBuffer[EAST] + (1 - p) * nHalf
+												: other + nHalf;
+			int start = (i + p) & 1;
+
+			for (int k = 0; k < nHalf; k++)
+			{
+				uint64_t right = (k + start == nHalf) ? RecvBuffer[NORTH][i] : other[k + start];
+
+				addSlices(up, cur[k]);
+				addSlices(anti, cur[k] ^ right);
+				addSlices(anti, cur[k] ^ down[k]);
+			}
+		}
+	}
+
+	flushSlices(up, nSlices, nUp);
+	flushSlices(anti, nSlices, nAnti);
+
+	for (int k = 0; k < WORD_BITS; k++)
+	{
+		spins[k] = 2 * nUp[k] - nData;
+		bonds[k] = 2 * (long)nData - 2 * nAnti[k];
+	}
+}
+
+
+/*
+ * check Grid and Machine size compatability and
+ * compute offsets of Grid relative to global
+ */
+void PackedField::checkGrid(void)
+{
+	// check machine size compatability
+	if (Host->nx * Host->ny != Host->nProc)
+	{
+		std::cout << "Incompatible grid parallelisation: "
+				  << Host->nx << " x " << Host->ny
+				  << " on " << Host->nProc << " processes\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// check local geometry compatability
+	nxLocal = nxGlobal / Host->nx;
+	if (nxLocal * Host->nx != nxGlobal)
+	{
+		std::cout << "Grid mismatch in X-dir\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	nyLocal = nyGlobal / Host->ny;
+	if (nyLocal * Host->ny != nyGlobal)
+	{
+		std::cout << "Grid mismatch in Y-dir\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// the sites of a half sweep are picked by local
+	// parity, which only matches the global one on even
+	// local grids
+	if (nxLocal % 2 != 0 || nyLocal % 2 != 0)
+	{
+		std::cout << "Local grid " << nxLocal << " x " << nyLocal
+				  << " is not even\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// a word per site for replicas
+	if (Replicas)
+	{
+		nWords = nyLocal;
+		nHalf = nyLocal / 2;
+		xOffset = Host->x * nxLocal;
+		yOffset = Host->y * nyLocal;
+		return;
+	}
+
+	// local rows are packed into whole words
+	nWords = nyLocal / WORD_BITS;
+	nHalf = 0;
+	if (nWords * WORD_BITS != nyLocal)
+	{
+		std::cout << "Local Y-dir size " << nyLocal
+				  << " is not a multiple of " << WORD_BITS << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// compute offsets relative to global coor system
+	xOffset = Host->x * nxLocal;
+	yOffset = Host->y * nyLocal;
+}
+
+};
+
+
+/*================ End of File ================*/
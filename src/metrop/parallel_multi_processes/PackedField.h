@@ -0,0 +1,89 @@
+/*=====================================================
+ * PackedField.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the class PackedField for
+ * bit-packed local lattice storage, 64 spins per word
+ *=====================================================*/
+
+
+#ifndef PACKEDFIELD_H_
+#define PACKEDFIELD_H_
+
+
+#include <iostream>
+#include <stdint.h>
+#include "mpi.h"
+
+#include "Field.h"
+#include "Machine.h"
+
+
+#define WORD_BITS 64  // # of spins in a packed word
+
+
+namespace wenchong
+{
+
+/*
+ * spin at local (row, col) is bit (col % 64) of word
+ * Data[row * nWords + col / 64], bit 1 is spin +1 and
+ * bit 0 is spin -1,
+ * with the layout of replicas a word is a site, and
+ * its bit k is the spin of replica k at local
+ * (row, col) in Planes[(row + col) & 1][row * nHalf + col / 2],
+ * the sites of a parity are contiguous as in Field,
+ * and the boundary rows hold the nHalf words of the
+ * EVEN sites, then those of the ODD sites
+ */
+class PackedField
+{
+public:
+	PackedField(Machine* m, bool replicas);
+	~PackedField();
+
+	void init(int initVal); // init Data array
+	long sumData(void);     // sum data in Data array
+	long sumBonds(void);    // sum of si * sj over the bonds
+	int operator() (int row, int col); // spin value +1/-1
+	void packBuffer(void);  // pack boundary to send
+
+	// spin and bond sums of every replica
+	void sumReplicas(long* spins, long* bonds);
+
+	bool Replicas;      // bit k of a word is replica k
+
+	int nxGlobal;       // # of points on global x-axis
+	int nyGlobal;       // # of points on global y-axis
+
+	int nData;          // # of active/local data
+	int nxLocal;        // # of points on local x-axis
+	int nyLocal;        // # of points on local y-axis
+	int nWords;         // # of packed words per row
+	int nHalf;          // # of words of a parity per row, for replicas
+
+	int xOffset;        // offset relative to global x-axis
+	int yOffset;        // offset relative to global y-axis
+
+	int nxBuffer;       // buffer size of x axis in words
+	int nyBuffer;       // buffer size of y axis in words
+
+	uint64_t* Data;          // packed data in the Field
+	uint64_t* Planes[2];     // EVEN and ODD sites of replicas in Data
+	uint64_t* SendBuffer[4]; // buffer of boundary data to send
+	uint64_t* RecvBuffer[4]; // buffer of boundary data to receive
+
+	Machine* Host;      // host processor
+
+private:
+	void checkGrid(void); // check Grid and Machine compatability
+	void packReplicas(void); // pack boundary of replicas
+};
+
+};
+
+
+#endif
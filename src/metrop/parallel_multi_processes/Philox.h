@@ -0,0 +1,85 @@
+/*=====================================================
+ * Philox.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file defines the counter-based random
+ * number generator Philox4x32-10 (Salmon et al., 2011),
+ * the output is a pure function of (counter, key),
+ * so no generator state is kept or shared
+ *=====================================================*/
+
+
+#ifndef PHILOX_H_
+#define PHILOX_H_
+
+
+#include <stdint.h>
+
+
+#define PHILOX_M0 0xD2511F53u  // round multipliers
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u  // key increments (Weyl)
+#define PHILOX_W1 0xBB67AE85u
+
+
+namespace wenchong
+{
+
+/*
+ * 4 random 32-bit numbers for the counter ctr under key,
+ * different counters give independent numbers
+ */
+inline void philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4])
+{
+	uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+	uint32_t k0 = key[0], k1 = key[1];
+
+	for (int round = 0; round < 10; round++)
+	{
+		uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+		uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+
+		c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c1 = (uint32_t)p1;
+		c3 = (uint32_t)p0;
+
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+
+/*
+ * the 64 numbers of a group, numbered so that a vector
+ * of 16 counters fills 16 contiguous numbers:
+ * out[16 * j + m] = output j of counter (16 * group + m, c1, c2, c3)
+ */
+inline void philoxGroup(uint32_t group, uint32_t c1, uint32_t c2, uint32_t c3,
+						const uint32_t key[2], uint32_t* out)
+{
+	uint32_t ctr[4] = {0, c1, c2, c3};
+	uint32_t r[4];
+
+	for (int m = 0; m < 16; m++)
+	{
+		ctr[0] = 16 * group + m;
+		philox4x32(ctr, key, r);
+
+		for (int j = 0; j < 4; j++)
+			out[16 * j + m] = r[j];
+	}
+}
+
+};
+
+
+#endif
@@ -0,0 +1,133 @@
+/*=====================================================
+ * Snapshot.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class Snapshot,
+ * the local rows are packed a byte per 8 spins and
+ * written through a subarray view of the global rows,
+ * so a 65536^2 lattice takes 512 MB
+ *=====================================================*/
+
+
+#include "Snapshot.h"
+
+
+namespace wenchong
+{
+
+/*
+ * set up the view of the local lattice in the global
+ * one, a local row must be whole bytes
+ */
+Snapshot::Snapshot(Machine* host, Field* f)
+{
+	Host = host;
+	Spins = f;
+
+	if (f->nyLocal % 8 != 0)
+	{
+		std::cout << "snapshot=... needs L / ny_p to be a multiple of 8\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	nBytes = f->nyLocal / 8;
+
+	int sizes[2] = {f->nxGlobal, f->nyGlobal / 8};
+	int subsizes[2] = {f->nxLocal, nBytes};
+	int starts[2] = {f->xOffset, f->yOffset / 8};
+
+	MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+							 MPI_BYTE, &Subarray);
+	MPI_Type_commit(&Subarray);
+
+	// snapaggr=K, a hint to gather the data of the
+	// collective writes on K processes, which write it
+	MPI_Info_create(&Hints);
+
+	const char* aggregators = host->getOption("snapaggr", "0");
+	if (atoi(aggregators) > 0)
+	{
+		MPI_Info_set(Hints, (char*)"romio_cb_write", (char*)"enable");
+		MPI_Info_set(Hints, (char*)"cb_nodes", (char*)aggregators);
+	}
+
+	Buffer = new uint8_t[(size_t)f->nxLocal * nBytes];
+}
+
+
+/*
+ * destructor: release resources
+ */
+Snapshot::~Snapshot()
+{
+	MPI_Type_free(&Subarray);
+	MPI_Info_free(&Hints);
+	delete [] Buffer;
+}
+
+
+/*
+ * write the spins of the global lattice to filename,
+ * collective over the processes of the lattice
+ */
+void Snapshot::write(const std::string& filename)
+{
+	MPI_File fh;
+
+	if (MPI_File_open(Host->Comm, (char*)filename.c_str(),
+					  MPI_MODE_CREATE | MPI_MODE_WRONLY, Hints, &fh) != MPI_SUCCESS)
+	{
+		std::cout << "P" << Host->Rank << ": cannot open snapshot " << filename << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	MPI_File_set_size(fh, 0);
+
+	packSpins();
+	MPI_File_set_view(fh, 0, MPI_BYTE, Subarray, (char*)"native", Hints);
+
+	if (MPI_File_write_all(fh, Buffer, Spins->nxLocal * nBytes, MPI_BYTE,
+						   MPI_STATUS_IGNORE) != MPI_SUCCESS)
+	{
+		std::cout << "P" << Host->Rank << ": cannot write snapshot " << filename << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	MPI_File_close(&fh);
+}
+
+
+/*
+ * pack the local rows, bit c of byte b of a row is
+ * the spin of col 8 * b + c, whose parity alternates
+ */
+void Snapshot::packSpins(void)
+{
+	#pragma omp parallel for schedule(static)
+	for (int row = 0; row < Spins->nxLocal; row++)
+	{
+		// col 8 * b + c is site b * 4 + c / 2 of parity
+		// (row + c) % 2, as 8 * b is even
+		const int* sites[2] = {Spins->Sites[row & 1] + row * Spins->nyStride,
+							   Spins->Sites[(row + 1) & 1] + row * Spins->nyStride};
+		uint8_t* bytes = Buffer + (size_t)row * nBytes;
+
+		for (int b = 0; b < nBytes; b++)
+		{
+			uint8_t byte = 0;
+
+			for (int c = 0; c < 8; c++)
+				byte |= (uint8_t)(sites[c & 1][4 * b + (c >> 1)] > 0) << c;
+
+			bytes[b] = byte;
+		}
+	}
+}
+
+};
+
+
+/*================ End of File ================*/
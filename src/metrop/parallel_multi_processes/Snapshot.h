@@ -0,0 +1,58 @@
+/*=====================================================
+ * Snapshot.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the class Snapshot that
+ * writes the spins of the distributed lattice to one
+ * global file, a bit per spin, with collective MPI-IO
+ *=====================================================*/
+
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+
+#include <string>
+#include <sstream>
+#include <stdint.h>
+#include "mpi.h"
+
+#include "Field.h"
+
+
+namespace wenchong
+{
+
+/*
+ * a snapshot file has nxGlobal rows of nyGlobal / 8
+ * bytes, spin (x, y) is bit y % 8 of byte
+ * x * nyGlobal / 8 + y / 8, set for spin +1,
+ * and no header
+ */
+class Snapshot
+{
+public:
+	Snapshot(Machine* host, Field* f);
+	~Snapshot();
+
+	void write(const std::string& filename);
+
+private:
+	Machine* Host;         // host processor
+	Field* Spins;          // the local lattice
+
+	int nBytes;            // # of bytes of a local row
+	MPI_Datatype Subarray; // local rows in the global ones
+	MPI_Info Hints;        // snapaggr=K: # of aggregators
+	uint8_t* Buffer;       // the packed local rows
+
+	void packSpins(void);
+};
+
+};
+
+
+#endif
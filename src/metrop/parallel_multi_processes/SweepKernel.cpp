@@ -0,0 +1,572 @@
+/*=====================================================
+ * SweepKernel.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the row kernels of
+ * the checkerboard Metropolis and heat-bath sweeps,
+ * the vector kernels are compiled for their target
+ * only and chosen at run time
+ *=====================================================*/
+
+
+#include <cstring>
+
+#include "SweepKernel.h"
+#include "Philox.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SWEEP_X86 1
+#include <immintrin.h>
+#endif
+
+
+namespace wenchong
+{
+
+/*
+ * scalar kernel, also finishes the tail of a row
+ * for the vector kernels
+ */
+void sweepRowScalar(int* cur, const int* left, const int* right,
+					const int* up, const int* down, int begin, int end,
+					const uint32_t* threshold, const uint32_t* rands,
+					long* delta)
+{
+	long magnet = 0, energy = 0;
+
+	for (int k = begin; k < end; k++)
+	{
+		int comb = cur[k] * (left[k] + right[k] + up[k] + down[k]);
+
+		// a flip changes the spin by -2 * si and
+		// the bond energy by 2 * [si * sum(sj)]
+		if (rands[k] <= threshold[(comb + 4) >> 1])
+		{
+			magnet -= cur[k];
+			energy += comb;
+			cur[k] = -cur[k];
+		}
+	}
+
+	delta[0] += 2 * magnet;
+	delta[1] += 2 * energy;
+}
+
+
+/*
+ * scalar heat-bath kernel, also finishes the tail of
+ * a row for the vector kernels
+ */
+void heatRowScalar(int* cur, const int* left, const int* right,
+				   const int* up, const int* down, int begin, int end,
+				   const uint32_t* threshold, const uint32_t* rands,
+				   long* delta)
+{
+	long magnet = 0, energy = 0;
+
+	for (int k = begin; k < end; k++)
+	{
+		int sum = left[k] + right[k] + up[k] + down[k];
+		int spin = (rands[k] <= threshold[(sum + 4) >> 1]) ? 1 : -1;
+
+		// the bond energy changes by -(new - old) * sum(sj)
+		magnet += spin - cur[k];
+		energy -= (spin - cur[k]) * sum;
+		cur[k] = spin;
+	}
+
+	delta[0] += magnet;
+	delta[1] += energy;
+}
+
+
+#ifdef SWEEP_X86
+
+/*
+ * AVX2 kernel: 8 sites per step
+ */
+__attribute__((target("avx2")))
+void sweepRowAVX2(int* cur, const int* left, const int* right,
+				  const int* up, const int* down, int begin, int end,
+				  const uint32_t* threshold, const uint32_t* rands,
+				  long* delta)
+{
+	const __m256i four = _mm256_set1_epi32(4);
+
+	// threshold[0..4] in a register, looked up by permutes
+	const __m256i table = _mm256_setr_epi32(threshold[0], threshold[1], threshold[2],
+											threshold[3], threshold[4], 0, 0, 0);
+
+	// per lane sums of the new spins and [si * sum(sj)]
+	// of the flipped sites
+	__m256i magnet = _mm256_setzero_si256();
+	__m256i energy = _mm256_setzero_si256();
+
+	int k = begin;
+
+	for (; k + 8 <= end; k += 8)
+	{
+		__m256i c = _mm256_loadu_si256((const __m256i*)(cur + k));
+		__m256i l = _mm256_loadu_si256((const __m256i*)(left + k));
+		__m256i r = _mm256_loadu_si256((const __m256i*)(right + k));
+		__m256i u = _mm256_loadu_si256((const __m256i*)(up + k));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(down + k));
+
+		// [si * sum(sj)] and its index in threshold
+		__m256i sum = _mm256_add_epi32(_mm256_add_epi32(l, r), _mm256_add_epi32(u, d));
+		__m256i comb = _mm256_mullo_epi32(c, sum);
+		__m256i idx = _mm256_srai_epi32(_mm256_add_epi32(comb, four), 1);
+
+		// look up the threshold and compare unsigned,
+		// r <= t is max(r, t) == t
+		__m256i t = _mm256_permutevar8x32_epi32(table, idx);
+		__m256i rand = _mm256_loadu_si256((const __m256i*)(rands + k));
+		__m256i flip = _mm256_cmpeq_epi32(_mm256_max_epu32(rand, t), t);
+
+		// negate the accepted sites: (c ^ m) - m
+		c = _mm256_sub_epi32(_mm256_xor_si256(c, flip), flip);
+
+		magnet = _mm256_add_epi32(magnet, _mm256_and_si256(c, flip));
+		energy = _mm256_add_epi32(energy, _mm256_and_si256(comb, flip));
+
+		_mm256_storeu_si256((__m256i*)(cur + k), c);
+	}
+
+	int sums[16];
+	_mm256_storeu_si256((__m256i*)sums, magnet);
+	_mm256_storeu_si256((__m256i*)(sums + 8), energy);
+
+	for (int i = 0; i < 8; i++)
+	{
+		delta[0] += 2 * sums[i];
+		delta[1] += 2 * sums[8 + i];
+	}
+
+	sweepRowScalar(cur, left, right, up, down, k, end, threshold, rands, delta);
+}
+
+
+/*
+ * AVX2 heat-bath kernel: 8 sites per step
+ */
+__attribute__((target("avx2")))
+void heatRowAVX2(int* cur, const int* left, const int* right,
+				 const int* up, const int* down, int begin, int end,
+				 const uint32_t* threshold, const uint32_t* rands,
+				 long* delta)
+{
+	const __m256i four = _mm256_set1_epi32(4);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i zero = _mm256_setzero_si256();
+
+	const __m256i table = _mm256_setr_epi32(threshold[0], threshold[1], threshold[2],
+											threshold[3], threshold[4], 0, 0, 0);
+
+	// per lane sums of the changes of the spins and
+	// of the bond energy
+	__m256i magnet = _mm256_setzero_si256();
+	__m256i energy = _mm256_setzero_si256();
+
+	int k = begin;
+
+	for (; k + 8 <= end; k += 8)
+	{
+		__m256i c = _mm256_loadu_si256((const __m256i*)(cur + k));
+		__m256i l = _mm256_loadu_si256((const __m256i*)(left + k));
+		__m256i r = _mm256_loadu_si256((const __m256i*)(right + k));
+		__m256i u = _mm256_loadu_si256((const __m256i*)(up + k));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(down + k));
+
+		// sum(sj) and its index in threshold
+		__m256i sum = _mm256_add_epi32(_mm256_add_epi32(l, r), _mm256_add_epi32(u, d));
+		__m256i idx = _mm256_srai_epi32(_mm256_add_epi32(sum, four), 1);
+
+		// spin up if r <= t: mask -1 --> +1, 0 --> -1
+		__m256i t = _mm256_permutevar8x32_epi32(table, idx);
+		__m256i rand = _mm256_loadu_si256((const __m256i*)(rands + k));
+		__m256i spinUp = _mm256_cmpeq_epi32(_mm256_max_epu32(rand, t), t);
+		__m256i spin = _mm256_sub_epi32(zero, _mm256_or_si256(spinUp, one));
+
+		__m256i change = _mm256_sub_epi32(spin, c);
+		magnet = _mm256_add_epi32(magnet, change);
+		energy = _mm256_sub_epi32(energy, _mm256_mullo_epi32(change, sum));
+
+		_mm256_storeu_si256((__m256i*)(cur + k), spin);
+	}
+
+	int sums[16];
+	_mm256_storeu_si256((__m256i*)sums, magnet);
+	_mm256_storeu_si256((__m256i*)(sums + 8), energy);
+
+	for (int i = 0; i < 8; i++)
+	{
+		delta[0] += sums[i];
+		delta[1] += sums[8 + i];
+	}
+
+	heatRowScalar(cur, left, right, up, down, k, end, threshold, rands, delta);
+}
+
+
+/*
+ * 32 x 32 --> 64-bit products of 8 lanes, split in
+ * the high and the low 32 bits
+ */
+__attribute__((target("avx2")))
+static inline void mulHiLoAVX2(__m256i a, __m256i m, __m256i* hi, __m256i* lo)
+{
+	__m256i even = _mm256_mul_epu32(a, m);
+	__m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+
+	*hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+	*lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+}
+
+
+/*
+ * Philox group with 8 counters per vector
+ */
+__attribute__((target("avx2")))
+void philoxGroupAVX2(uint32_t group, uint32_t c1, uint32_t c2, uint32_t c3,
+					 const uint32_t key[2], uint32_t* out)
+{
+	const __m256i m0 = _mm256_set1_epi32(PHILOX_M0);
+	const __m256i m1 = _mm256_set1_epi32(PHILOX_M1);
+
+	for (int half = 0; half < 2; half++)
+	{
+		__m256i x0 = _mm256_add_epi32(_mm256_set1_epi32(16 * group + 8 * half),
+									  _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		__m256i x1 = _mm256_set1_epi32(c1);
+		__m256i x2 = _mm256_set1_epi32(c2);
+		__m256i x3 = _mm256_set1_epi32(c3);
+		uint32_t k0 = key[0], k1 = key[1];
+
+		for (int round = 0; round < 10; round++)
+		{
+			__m256i hi0, lo0, hi1, lo1;
+			mulHiLoAVX2(x0, m0, &hi0, &lo0);
+			mulHiLoAVX2(x2, m1, &hi1, &lo1);
+
+			x0 = _mm256_xor_si256(_mm256_xor_si256(hi1, x1), _mm256_set1_epi32(k0));
+			x2 = _mm256_xor_si256(_mm256_xor_si256(hi0, x3), _mm256_set1_epi32(k1));
+			x1 = lo1;
+			x3 = lo0;
+
+			k0 += PHILOX_W0;
+			k1 += PHILOX_W1;
+		}
+
+		_mm256_storeu_si256((__m256i*)(out + 8 * half), x0);
+		_mm256_storeu_si256((__m256i*)(out + 16 + 8 * half), x1);
+		_mm256_storeu_si256((__m256i*)(out + 32 + 8 * half), x2);
+		_mm256_storeu_si256((__m256i*)(out + 48 + 8 * half), x3);
+	}
+}
+
+
+/*
+ * AVX-512 kernel: 16 sites per step,
+ * flipped under a mask register
+ */
+__attribute__((target("avx512f")))
+void sweepRowAVX512(int* cur, const int* left, const int* right,
+					const int* up, const int* down, int begin, int end,
+					const uint32_t* threshold, const uint32_t* rands,
+					long* delta)
+{
+	const __m512i four = _mm512_set1_epi32(4);
+	const __m512i zero = _mm512_setzero_si512();
+
+	// threshold[0..4] in a register, looked up by permutes
+	const __m512i table = _mm512_maskz_loadu_epi32(0x1F, threshold);
+
+	// per lane sums of the new spins and [si * sum(sj)]
+	// of the flipped sites
+	__m512i magnet = _mm512_setzero_si512();
+	__m512i energy = _mm512_setzero_si512();
+
+	int k = begin;
+
+	for (; k + 16 <= end; k += 16)
+	{
+		__m512i c = _mm512_loadu_si512((const void*)(cur + k));
+		__m512i l = _mm512_loadu_si512((const void*)(left + k));
+		__m512i r = _mm512_loadu_si512((const void*)(right + k));
+		__m512i u = _mm512_loadu_si512((const void*)(up + k));
+		__m512i d = _mm512_loadu_si512((const void*)(down + k));
+
+		// [si * sum(sj)] and its index in threshold
+		__m512i sum = _mm512_add_epi32(_mm512_add_epi32(l, r), _mm512_add_epi32(u, d));
+		__m512i comb = _mm512_mullo_epi32(c, sum);
+		__m512i idx = _mm512_srai_epi32(_mm512_add_epi32(comb, four), 1);
+
+		// look up the threshold and compare unsigned
+		__m512i t = _mm512_permutexvar_epi32(idx, table);
+		__m512i rand = _mm512_loadu_si512((const void*)(rands + k));
+		__mmask16 flip = _mm512_cmple_epu32_mask(rand, t);
+
+		// negate the accepted sites
+		c = _mm512_mask_sub_epi32(c, flip, zero, c);
+
+		magnet = _mm512_mask_add_epi32(magnet, flip, magnet, c);
+		energy = _mm512_mask_add_epi32(energy, flip, energy, comb);
+
+		_mm512_storeu_si512((void*)(cur + k), c);
+	}
+
+	delta[0] += 2 * (long)_mm512_reduce_add_epi32(magnet);
+	delta[1] += 2 * (long)_mm512_reduce_add_epi32(energy);
+
+	sweepRowScalar(cur, left, right, up, down, k, end, threshold, rands, delta);
+}
+
+
+/*
+ * AVX-512 heat-bath kernel: 16 sites per step,
+ * the new spins are set under a mask register
+ */
+__attribute__((target("avx512f")))
+void heatRowAVX512(int* cur, const int* left, const int* right,
+				   const int* up, const int* down, int begin, int end,
+				   const uint32_t* threshold, const uint32_t* rands,
+				   long* delta)
+{
+	const __m512i four = _mm512_set1_epi32(4);
+	const __m512i one = _mm512_set1_epi32(1);
+	const __m512i minusOne = _mm512_set1_epi32(-1);
+
+	const __m512i table = _mm512_maskz_loadu_epi32(0x1F, threshold);
+
+	// per lane sums of the changes of the spins and
+	// of the bond energy
+	__m512i magnet = _mm512_setzero_si512();
+	__m512i energy = _mm512_setzero_si512();
+
+	int k = begin;
+
+	for (; k + 16 <= end; k += 16)
+	{
+		__m512i c = _mm512_loadu_si512((const void*)(cur + k));
+		__m512i l = _mm512_loadu_si512((const void*)(left + k));
+		__m512i r = _mm512_loadu_si512((const void*)(right + k));
+		__m512i u = _mm512_loadu_si512((const void*)(up + k));
+		__m512i d = _mm512_loadu_si512((const void*)(down + k));
+
+		// sum(sj) and its index in threshold
+		__m512i sum = _mm512_add_epi32(_mm512_add_epi32(l, r), _mm512_add_epi32(u, d));
+		__m512i idx = _mm512_srai_epi32(_mm512_add_epi32(sum, four), 1);
+
+		// spin up if r <= t
+		__m512i t = _mm512_permutexvar_epi32(idx, table);
+		__m512i rand = _mm512_loadu_si512((const void*)(rands + k));
+		__mmask16 spinUp = _mm512_cmple_epu32_mask(rand, t);
+		__m512i spin = _mm512_mask_blend_epi32(spinUp, minusOne, one);
+
+		__m512i change = _mm512_sub_epi32(spin, c);
+		magnet = _mm512_add_epi32(magnet, change);
+		energy = _mm512_sub_epi32(energy, _mm512_mullo_epi32(change, sum));
+
+		_mm512_storeu_si512((void*)(cur + k), spin);
+	}
+
+	delta[0] += (long)_mm512_reduce_add_epi32(magnet);
+	delta[1] += (long)_mm512_reduce_add_epi32(energy);
+
+	heatRowScalar(cur, left, right, up, down, k, end, threshold, rands, delta);
+}
+
+
+/*
+ * 32 x 32 --> 64-bit products of 16 lanes, split in
+ * the high and the low 32 bits
+ */
+__attribute__((target("avx512f")))
+static inline void mulHiLoAVX512(__m512i a, __m512i m, __m512i* hi, __m512i* lo)
+{
+	__m512i even = _mm512_mul_epu32(a, m);
+	__m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), m);
+
+	*hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+	*lo = _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+}
+
+
+/*
+ * Philox group with 16 counters per vector
+ */
+__attribute__((target("avx512f")))
+void philoxGroupAVX512(uint32_t group, uint32_t c1, uint32_t c2, uint32_t c3,
+					   const uint32_t key[2], uint32_t* out)
+{
+	const __m512i m0 = _mm512_set1_epi32(PHILOX_M0);
+	const __m512i m1 = _mm512_set1_epi32(PHILOX_M1);
+
+	__m512i x0 = _mm512_add_epi32(_mm512_set1_epi32(16 * group),
+								  _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+													8, 9, 10, 11, 12, 13, 14, 15));
+	__m512i x1 = _mm512_set1_epi32(c1);
+	__m512i x2 = _mm512_set1_epi32(c2);
+	__m512i x3 = _mm512_set1_epi32(c3);
+	uint32_t k0 = key[0], k1 = key[1];
+
+	for (int round = 0; round < 10; round++)
+	{
+		__m512i hi0, lo0, hi1, lo1;
+		mulHiLoAVX512(x0, m0, &hi0, &lo0);
+		mulHiLoAVX512(x2, m1, &hi1, &lo1);
+
+		x0 = _mm512_xor_si512(_mm512_xor_si512(hi1, x1), _mm512_set1_epi32(k0));
+		x2 = _mm512_xor_si512(_mm512_xor_si512(hi0, x3), _mm512_set1_epi32(k1));
+		x1 = lo1;
+		x3 = lo0;
+
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+
+	_mm512_storeu_si512((void*)out, x0);
+	_mm512_storeu_si512((void*)(out + 16), x1);
+	_mm512_storeu_si512((void*)(out + 32), x2);
+	_mm512_storeu_si512((void*)(out + 48), x3);
+}
+
+#else
+
+void sweepRowAVX2(int* cur, const int* left, const int* right,
+				  const int* up, const int* down, int begin, int end,
+				  const uint32_t* threshold, const uint32_t* rands,
+				  long* delta)
+{
+	sweepRowScalar(cur, left, right, up, down, begin, end, threshold, rands, delta);
+}
+
+
+void sweepRowAVX512(int* cur, const int* left, const int* right,
+					const int* up, const int* down, int begin, int end,
+					const uint32_t* threshold, const uint32_t* rands,
+					long* delta)
+{
+	sweepRowScalar(cur, left, right, up, down, begin, end, threshold, rands, delta);
+}
+
+
+void heatRowAVX2(int* cur, const int* left, const int* right,
+				 const int* up, const int* down, int begin, int end,
+				 const uint32_t* threshold, const uint32_t* rands,
+				 long* delta)
+{
+	heatRowScalar(cur, left, right, up, down, begin, end, threshold, rands, delta);
+}
+
+
+void heatRowAVX512(int* cur, const int* left, const int* right,
+				   const int* up, const int* down, int begin, int end,
+				   const uint32_t* threshold, const uint32_t* rands,
+				   long* delta)
+{
+	heatRowScalar(cur, left, right, up, down, begin, end, threshold, rands, delta);
+}
+
+
+void philoxGroupAVX2(uint32_t group, uint32_t c1, uint32_t c2, uint32_t c3,
+					 const uint32_t key[2], uint32_t* out)
+{
+	philoxGroup(group, c1, c2, c3, key, out);
+}
+
+
+void philoxGroupAVX512(uint32_t group, uint32_t c1, uint32_t c2, uint32_t c3,
+					   const uint32_t key[2], uint32_t* out)
+{
+	philoxGroup(group, c1, c2, c3, key, out);
+}
+
+#endif
+
+
+/*
+ * choose a kernel by name, "auto" picks the widest
+ * kernel that the CPU supports
+ */
+SweepKernel selectSweepKernel(const char* name)
+{
+	bool hasAVX2 = false;
+	bool hasAVX512 = false;
+
+#ifdef SWEEP_X86
+	__builtin_cpu_init();
+	hasAVX2 = __builtin_cpu_supports("avx2");
+	hasAVX512 = __builtin_cpu_supports("avx512f");
+#endif
+
+	if (strcmp(name, "scalar") == 0)
+		return sweepRowScalar;
+
+	if (strcmp(name, "avx2") == 0)
+		return hasAVX2 ? sweepRowAVX2 : NULL;
+
+	if (strcmp(name, "avx512") == 0)
+		return hasAVX512 ? sweepRowAVX512 : NULL;
+
+	if (strcmp(name, "auto") == 0)
+	{
+		if (hasAVX512)
+			return sweepRowAVX512;
+
+		if (hasAVX2)
+			return sweepRowAVX2;
+
+		return sweepRowScalar;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * choose the heat-bath kernel matching the sweep kernel
+ */
+SweepKernel selectHeatKernel(const char* name)
+{
+	SweepKernel sweep = selectSweepKernel(name);
+
+	if (sweep == sweepRowAVX512)
+		return heatRowAVX512;
+
+	if (sweep == sweepRowAVX2)
+		return heatRowAVX2;
+
+	if (sweep == sweepRowScalar)
+		return heatRowScalar;
+
+	return NULL;
+}
+
+
+/*
+ * choose the Philox kernel matching the sweep kernel
+ */
+RandKernel selectRandKernel(const char* name)
+{
+	SweepKernel sweep = selectSweepKernel(name);
+
+	if (sweep == sweepRowAVX512)
+		return philoxGroupAVX512;
+
+	if (sweep == sweepRowAVX2)
+		return philoxGroupAVX2;
+
+	if (sweep == sweepRowScalar)
+		return philoxGroup;
+
+	return NULL;
+}
+
+};
+
+
+/*================ End of File ================*/
@@ -0,0 +1,96 @@
+/*=====================================================
+ * SweepKernel.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the row kernels of the
+ * checkerboard Metropolis and heat-bath sweeps, a
+ * scalar version and AVX2/AVX-512 versions chosen by
+ * CPU features
+ *=====================================================*/
+
+
+#ifndef SWEEPKERNEL_H_
+#define SWEEPKERNEL_H_
+
+
+#include <stdint.h>
+
+
+namespace wenchong
+{
+
+/*
+ * update the sites cur[k] for k = begin, ..., end-1 of
+ * one row of a sublattice, the neighbours of cur[k] are
+ * left[k], right[k], up[k] and down[k] in the other
+ * sublattice, a site is flipped if the raw 32-bit
+ * random number rands[k] <= threshold[(cur[k] * sum(neighbours) + 4) / 2],
+ * the change of the sum of the spins is added to delta[0]
+ * and the change of the bond energy to delta[1]
+ */
+typedef void (*SweepKernel)(int* cur, const int* left, const int* right,
+							const int* up, const int* down, int begin, int end,
+							const uint32_t* threshold, const uint32_t* rands,
+							long* delta);
+
+void sweepRowScalar(int* cur, const int* left, const int* right,
+					const int* up, const int* down, int begin, int end,
+					const uint32_t* threshold, const uint32_t* rands,
+					long* delta);
+
+void sweepRowAVX2(int* cur, const int* left, const int* right,
+				  const int* up, const int* down, int begin, int end,
+				  const uint32_t* threshold, const uint32_t* rands,
+				  long* delta);
+
+void sweepRowAVX512(int* cur, const int* left, const int* right,
+					const int* up, const int* down, int begin, int end,
+					const uint32_t* threshold, const uint32_t* rands,
+					long* delta);
+
+/*
+ * heat-bath versions of the row kernels: cur[k] is set
+ * to +1 if rands[k] <= threshold[(sum(neighbours) + 4) / 2],
+ * and to -1 otherwise, the changes are added to delta
+ */
+void heatRowScalar(int* cur, const int* left, const int* right,
+				   const int* up, const int* down, int begin, int end,
+				   const uint32_t* threshold, const uint32_t* rands,
+				   long* delta);
+
+void heatRowAVX2(int* cur, const int* left, const int* right,
+				 const int* up, const int* down, int begin, int end,
+				 const uint32_t* threshold, const uint32_t* rands,
+				 long* delta);
+
+void heatRowAVX512(int* cur, const int* left, const int* right,
+				   const int* up, const int* down, int begin, int end,
+				   const uint32_t* threshold, const uint32_t* rands,
+				   long* delta);
+
+/*
+ * the 64 Philox numbers of a group as philoxGroup() in Philox.h,
+ * the vector versions run 8 or 16 counters per instruction
+ */
+typedef void (*RandKernel)(uint32_t group, uint32_t c1, uint32_t c2, uint32_t c3,
+						   const uint32_t key[2], uint32_t* out);
+
+void philoxGroupAVX2(uint32_t group, uint32_t c1, uint32_t c2, uint32_t c3,
+					 const uint32_t key[2], uint32_t* out);
+
+void philoxGroupAVX512(uint32_t group, uint32_t c1, uint32_t c2, uint32_t c3,
+					   const uint32_t key[2], uint32_t* out);
+
+// kernel by name: "auto", "scalar", "avx2" or "avx512",
+// NULL if unknown or not supported by the CPU
+SweepKernel selectSweepKernel(const char* name);
+SweepKernel selectHeatKernel(const char* name);
+RandKernel selectRandKernel(const char* name);
+
+};
+
+
+#endif
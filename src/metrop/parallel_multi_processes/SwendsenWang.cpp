@@ -0,0 +1,383 @@
+/*=====================================================
+ * SwendsenWang.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class
+ * SwendsenWang, a sweep activates the bonds of equal
+ * neighbours, labels the clusters by union-find on
+ * each process, merges the labels of the clusters
+ * across processes and flips every cluster with
+ * probability 1/2
+ *=====================================================*/
+
+
+#include "SwendsenWang.h"
+
+
+namespace wenchong
+{
+
+/*
+ * construct the 2D lattice system
+ */
+SwendsenWang::SwendsenWang(Machine* host, int init, double beta, unsigned int seed)
+	 : BaseLattice(host, init, beta, seed)
+{
+	setBeta(beta);
+
+	// the bonds and the flips are keyed by the global
+	// seed and drawn by global sites and labels, so they
+	// do not depend on the decomposition
+	Key[0] = host->Seed;
+	Key[1] = host->Replica;
+	Sweep = 0;
+
+	Parent = new int[Size];
+	Label = new long[Size];
+	Flip = new bool[Size];
+
+	nBoundary[NORTH] = nRow;
+	nBoundary[SOUTH] = nRow;
+	nBoundary[EAST] = nCol;
+	nBoundary[WEST] = nCol;
+
+	for (int dir = 0; dir < 4; dir++)
+	{
+		Bonded[dir] = new bool[nBoundary[dir]];
+		SendLabels[dir] = new long[nBoundary[dir]];
+		RecvLabels[dir] = new long[nBoundary[dir]];
+	}
+}
+
+
+/*
+ * destructor: release resources
+ */
+SwendsenWang::~SwendsenWang()
+{
+	delete [] Parent;
+	delete [] Label;
+	delete [] Flip;
+
+	for (int dir = 0; dir < 4; dir++)
+	{
+		delete [] Bonded[dir];
+		delete [] SendLabels[dir];
+		delete [] RecvLabels[dir];
+	}
+}
+
+
+/*
+ * set Beta and pre-compute the bond probability of it
+ */
+void SwendsenWang::setBeta(double beta)
+{
+	Beta = beta;
+
+	// a bond of equal neighbours is active with
+	// probability 1 - exp(-2 * Beta)
+	Factor = -2 * Beta;
+	Threshold = acceptThreshold(1 - exp(Factor));
+}
+
+
+/*
+ * update the local lattice by whole sweeps, the spins
+ * of the ghost cells are exchanged after the flips
+ */
+void SwendsenWang::update(int numSweeps)
+{
+	for (int i = 0; i < numSweeps; i++)
+	{
+		labelLocal();
+		mergeLabels();
+		flipClusters();
+
+		Comms->sendBoundaryData(Spins, EVEN);
+		Comms->sendBoundaryData(Spins, ODD);
+
+		// a sweep flips a large part of the lattice,
+		// so the totals are summed up again
+		Magnet = Spins->sumData();
+		Energy = -Spins->sumBonds();
+
+		Sweep++;
+	}
+}
+
+
+/*
+ * spin of a local site or a ghost cell, without the
+ * bounds check of Field::operator()
+ */
+int& SwendsenWang::spin(int row, int col)
+{
+	return Spins->Sites[(row + col) & 1][row * Spins->nyStride + (col >> 1)];
+}
+
+
+/*
+ * index of a local site or a ghost cell on the global
+ * lattice, the ghost cells are wrapped around
+ */
+long SwendsenWang::globalIndex(int row, int col)
+{
+	long globalRow = (Spins->xOffset + row + Spins->nxGlobal) % Spins->nxGlobal;
+	long globalCol = (Spins->yOffset + col + Spins->nyGlobal) % Spins->nyGlobal;
+
+	return globalRow * Spins->nyGlobal + globalCol;
+}
+
+
+/*
+ * the random numbers of the bonds of a site to its
+ * right neighbour, rands[0], and to its lower
+ * neighbour, rands[1], so the process of a ghost cell
+ * draws the same numbers for its bonds
+ */
+void SwendsenWang::bondRands(int row, int col, uint32_t rands[4])
+{
+	long index = globalIndex(row, col);
+
+	uint32_t ctr[4] = {(uint32_t)(index % Spins->nyGlobal),
+					   (uint32_t)(index / Spins->nyGlobal),
+					   (uint32_t)Sweep, SW_BONDS};
+
+	philox4x32(ctr, Key, rands);
+}
+
+
+/*
+ * root of the local cluster of a site, with path halving
+ */
+int SwendsenWang::findRoot(int site)
+{
+	while (Parent[site] != site)
+	{
+		Parent[site] = Parent[Parent[site]];
+		site = Parent[site];
+	}
+
+	return site;
+}
+
+
+/*
+ * join the local clusters of two sites, the smaller
+ * index becomes the root
+ */
+void SwendsenWang::unite(int a, int b)
+{
+	int rootA = findRoot(a);
+	int rootB = findRoot(b);
+
+	if (rootA < rootB)
+		Parent[rootB] = rootA;
+	else if (rootB < rootA)
+		Parent[rootA] = rootB;
+}
+
+
+/*
+ * local index of the boundary site t next to the
+ * neighbour dir: row t for North/South, col t for
+ * East/West
+ */
+int SwendsenWang::boundarySite(int dir, int t)
+{
+	switch (dir)
+	{
+		case NORTH: return t * nCol + nCol - 1;
+		case SOUTH: return t * nCol;
+		case EAST:  return (nRow - 1) * nCol + t;
+		default:    return t;
+	}
+}
+
+
+/*
+ * activate the bonds and label the clusters of the
+ * local sites, a local cluster is labelled by the
+ * global index of its root, the smallest one as the
+ * local indices follow the global ones,
+ * the bonds to the ghost cells are activated the same
+ * way as on the process that holds them
+ */
+void SwendsenWang::labelLocal(void)
+{
+	uint32_t rands[4];
+
+	for (int s = 0; s < Size; s++)
+		Parent[s] = s;
+
+	for (int i = 0; i < nRow; i++)
+	{
+		for (int j = 0; j < nCol; j++)
+		{
+			int s = i * nCol + j;
+			int current = spin(i, j);
+
+			bool right = (j + 1 < nCol) && spin(i, j + 1) == current;
+			bool down = (i + 1 < nRow) && spin(i + 1, j) == current;
+
+			if (!right && !down)
+				continue;
+
+			bondRands(i, j, rands);
+
+			if (right && rands[0] <= Threshold)
+				unite(s, s + 1);
+
+			if (down && rands[1] <= Threshold)
+				unite(s, s + nCol);
+		}
+	}
+
+	// bonds across the boundaries, a bond to the south
+	// or west belongs to the ghost cell
+	for (int i = 0; i < nRow; i++)
+	{
+		bondRands(i, nCol - 1, rands);
+		Bonded[NORTH][i] = spin(i, nCol - 1) == spin(i, nCol) && rands[0] <= Threshold;
+
+		bondRands(i, -1, rands);
+		Bonded[SOUTH][i] = spin(i, 0) == spin(i, -1) && rands[0] <= Threshold;
+	}
+
+	for (int j = 0; j < nCol; j++)
+	{
+		bondRands(nRow - 1, j, rands);
+		Bonded[EAST][j] = spin(nRow - 1, j) == spin(nRow, j) && rands[1] <= Threshold;
+
+		bondRands(-1, j, rands);
+		Bonded[WEST][j] = spin(0, j) == spin(-1, j) && rands[1] <= Threshold;
+	}
+
+	// point every site at its root, and label the roots
+	for (int s = 0; s < Size; s++)
+	{
+		Parent[s] = findRoot(s);
+
+		if (Parent[s] == s)
+			Label[s] = globalIndex(s / nCol, s % nCol);
+	}
+}
+
+
+/*
+ * merge the labels of the clusters across processes:
+ * the labels of the boundary sites are exchanged and
+ * a local cluster bonded to a smaller label takes it,
+ * until no label changes on any process, then every
+ * cluster has the smallest global index of its sites
+ */
+void SwendsenWang::mergeLabels(void)
+{
+	bool changed;
+
+	do
+	{
+		for (int dir = 0; dir < 4; dir++)
+			for (int t = 0; t < nBoundary[dir]; t++)
+				SendLabels[dir][t] = Label[Parent[boundarySite(dir, t)]];
+
+		Comms->sendBoundaryLabels(SendLabels, RecvLabels, nBoundary);
+
+		// the neighbour has drawn the same bonds
+		changed = false;
+
+		for (int dir = 0; dir < 4; dir++)
+		{
+			for (int t = 0; t < nBoundary[dir]; t++)
+			{
+				int root = Parent[boundarySite(dir, t)];
+
+				if (Bonded[dir][t] && RecvLabels[dir][t] < Label[root])
+				{
+					Label[root] = RecvLabels[dir][t];
+					changed = true;
+				}
+			}
+		}
+	}
+	while (Comms->computeGlobalOr(changed));
+}
+
+
+/*
+ * flip every cluster with probability 1/2, drawn by
+ * its global label, so the parts of a cluster on
+ * different processes agree
+ */
+void SwendsenWang::flipClusters(void)
+{
+	#pragma omp parallel for schedule(static)
+	for (int s = 0; s < Size; s++)
+	{
+		if (Parent[s] != s)
+			continue;
+
+		uint32_t ctr[4] = {(uint32_t)Label[s], (uint32_t)(Label[s] >> 32),
+						   (uint32_t)Sweep, SW_FLIPS};
+		uint32_t rands[4];
+
+		philox4x32(ctr, Key, rands);
+		Flip[s] = (rands[0] >> 31) != 0;
+	}
+
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < nRow; i++)
+	{
+		for (int j = 0; j < nCol; j++)
+		{
+			if (Flip[Parent[i * nCol + j]])
+				spin(i, j) = -spin(i, j);
+		}
+	}
+}
+
+
+/*
+ * DO NOT use this function,
+ * the clusters are updated by whole sweeps in update
+ */
+void SwendsenWang::updateLattice(int /*evenOddFlag*/)
+{
+}
+
+
+/*
+ * DO NOT use this function,
+ * the bonds are activated in labelLocal
+ */
+bool SwendsenWang::isAccept(int /*row*/, int /*col*/)
+{
+	return false;
+}
+
+
+/*
+ * the Philox counter, # of sweeps
+ */
+unsigned int SwendsenWang::getCounter(void)
+{
+	return Sweep;
+}
+
+
+/*
+ * restore the Philox counter of a checkpoint
+ */
+void SwendsenWang::setCounter(unsigned int counter)
+{
+	Sweep = counter;
+}
+
+};
+
+
+/*================ End of File ================*/
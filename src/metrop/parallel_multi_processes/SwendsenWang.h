@@ -0,0 +1,75 @@
+/*=====================================================
+ * SwendsenWang.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the class SwendsenWang
+ * that implements the Swendsen-Wang cluster algorithm
+ * on the domain decomposition of Field
+ *=====================================================*/
+
+
+#ifndef SWENDSENWANG_H_
+#define SWENDSENWANG_H_
+
+
+#include "BaseLattice.h"
+#include "Acceptance.h"
+#include "Philox.h"
+
+
+// Philox streams (counter word 3) of the bonds and the
+// cluster flips, Metrop uses 0 and 1 for the parities
+#define SW_BONDS 2
+#define SW_FLIPS 3
+
+
+namespace wenchong
+{
+
+class SwendsenWang : public BaseLattice
+{
+public:
+	SwendsenWang(Machine* host, int init, double beta, unsigned int seed);
+	~SwendsenWang();
+
+	virtual void update(int numSweeps);
+	virtual void setBeta(double beta);
+
+private:
+	uint32_t Threshold;   // 1 - exp(-2 * Beta) as 32-bit threshold
+	uint32_t Key[2];      // Philox key: global seed, stream
+	unsigned int Sweep;   // # of sweeps done, Philox counter
+
+	int* Parent;          // union-find forest of the local sites
+	long* Label;          // global label of a local root
+	bool* Flip;           // flip of the cluster of a local root
+
+	// per direction: the crossing bonds of the boundary
+	// sites, and the labels sent and received
+	int nBoundary[4];
+	bool* Bonded[4];
+	long* SendLabels[4];
+	long* RecvLabels[4];
+
+	int& spin(int row, int col);
+	long globalIndex(int row, int col);
+	void bondRands(int row, int col, uint32_t rands[4]);
+	int findRoot(int site);
+	void unite(int a, int b);
+	int boundarySite(int dir, int t);
+	void labelLocal(void);
+	void mergeLabels(void);
+	void flipClusters(void);
+	virtual void updateLattice(int evenOddFlag);
+	virtual bool isAccept(int row, int col);
+	virtual unsigned int getCounter(void);
+	virtual void setCounter(unsigned int counter);
+};
+
+};
+
+
+#endif
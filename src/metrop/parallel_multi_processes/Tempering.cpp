@@ -0,0 +1,251 @@
+/*=====================================================
+ * Tempering.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class Tempering,
+ * parallel tempering: every process grid updates a
+ * replica at a beta of the ladder, and neighbouring
+ * betas are swapped between the replicas by their
+ * energies, only the betas move, not the spins
+ *=====================================================*/
+
+
+#include "Tempering.h"
+
+
+namespace wenchong
+{
+
+/*
+ * construct the ladder of betas=b0,b1,... and set
+ * the first beta of the replica of this process
+ */
+Tempering::Tempering(Machine* host, BaseLattice* lattice)
+{
+	Host = host;
+	Lattice = lattice;
+	Comms = new Communicator(host);
+
+	nBetas = host->nReplicas;
+	Ladder = new double[nBetas];
+	BetaOf = new int[nBetas];
+	ReplicaAt = new int[nBetas];
+	Sums = new double[2 * nBetas];
+	nTried = new long[nBetas];
+	nAccepted = new long[nBetas];
+
+	std::stringstream betas(host->getOption("betas", ""));
+	std::string beta;
+
+	for (int k = 0; k < nBetas; k++)
+	{
+		std::getline(betas, beta, ',');
+		Ladder[k] = atof(beta.c_str());
+
+		if (Ladder[k] <= 0.0)
+		{
+			std::cout << "Invalid beta: " << beta << "\n";
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+
+		BetaOf[k] = k;
+		ReplicaAt[k] = k;
+		nTried[k] = 0;
+		nAccepted[k] = 0;
+	}
+
+	nSites = (double)atoi(host->Argv[1]) * (double)atoi(host->Argv[2]);
+
+	// swap=N, try to swap the betas every N sweeps
+	Interval = atoi(host->getOption("swap", "10"));
+	if (Interval < 1)
+	{
+		std::cout << "Invalid swap interval: " << Interval << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	// the swaps are drawn the same on all processes
+	nSweepsDone = 0;
+	Attempts = 0;
+	Key[0] = host->Seed;
+	Key[1] = 0;
+
+	Lattice->setBeta(Ladder[BetaOf[host->Replica]]);
+
+	SeriesXt = NULL;
+	SeriesEt = NULL;
+
+	// only write output to file inside one process
+	if (host->Rank == ROOT && host->Replica == 0)
+	{
+		SeriesXt = new TimeSeries[nBetas];
+		SeriesEt = new TimeSeries[nBetas];
+
+		const char* algo = host->getOption("algo", "metrop");
+		int L = atoi(host->Argv[1]);
+
+		for (int k = 0; k < nBetas; k++)
+		{
+			std::stringstream filenameXt, filenameEt;
+			filenameXt << "xt." << k << ".bin";
+			filenameEt << "et." << k << ".bin";
+
+			SeriesXt[k].open(filenameXt.str(), TimeSeries::makeHeader("xt", algo,
+							 L, L, 1, host->nSweeps, host->Seed, Ladder[k]), 0);
+			SeriesEt[k].open(filenameEt.str(), TimeSeries::makeHeader("et", algo,
+							 L, L, 1, host->nSweeps, host->Seed, Ladder[k]), 0);
+		}
+	}
+}
+
+
+/*
+ * destructor: release resources
+ */
+Tempering::~Tempering()
+{
+	delete Comms;
+	delete [] Ladder;
+	delete [] BetaOf;
+	delete [] ReplicaAt;
+	delete [] Sums;
+	delete [] nTried;
+	delete [] nAccepted;
+	delete [] SeriesXt;
+	delete [] SeriesEt;
+}
+
+
+/*
+ * thermalize and measure all replicas, X and the
+ * energy per site go to xt.k.bin and et.k.bin by the
+ * beta index k, whichever replica is at it,
+ * then print the acceptance of the swaps
+ */
+void Tempering::run(void)
+{
+	sweep(Host->nThrow);
+
+	for (int i = 0; i < Host->Measures; i++)
+	{
+		sweep(Host->nSweeps);
+		measure();
+	}
+
+	if (Host->Rank == ROOT && Host->Replica == 0)
+	{
+		for (int k = 0; k < nBetas; k++)
+		{
+			SeriesXt[k].close();
+			SeriesEt[k].close();
+		}
+
+		for (int k = 0; k + 1 < nBetas; k++)
+		{
+			double rate = (nTried[k] > 0) ? (double)nAccepted[k] / nTried[k] : 0.0;
+
+			std::cout << "beta " << Ladder[k] << " <-> " << Ladder[k + 1]
+					  << ": swap acceptance " << rate << "\n";
+		}
+	}
+}
+
+
+/*
+ * sweep the replica and try the swaps every
+ * Interval sweeps of the run
+ */
+void Tempering::sweep(int numSweeps)
+{
+	for (int i = 0; i < numSweeps; i++)
+	{
+		Lattice->update(1);
+		nSweepsDone++;
+
+		if (nSweepsDone % Interval == 0)
+			swapBetas();
+	}
+}
+
+
+/*
+ * the global spin and bond sums of every replica
+ * on all processes: Sums[2 * r] and Sums[2 * r + 1]
+ */
+void Tempering::gatherSums(void)
+{
+	double localSums[2], globalSums[2];
+
+	Lattice->measureLocal(localSums);
+	Comms->computeGlobalSum(localSums, globalSums, 2);
+	Comms->gatherReplicas(globalSums, Sums, 2);
+}
+
+
+/*
+ * try to swap the betas of the pairs of neighbouring
+ * indices (k, k+1), even k and odd k in turns,
+ * with probability min(1, exp((b_k - b_k+1) * (E_k - E_k+1)))
+ * for the energies E of the replicas at them,
+ * all processes draw the same swaps
+ */
+void Tempering::swapBetas(void)
+{
+	gatherSums();
+
+	for (int k = Attempts % 2; k + 1 < nBetas; k += 2)
+	{
+		int a = ReplicaAt[k];
+		int b = ReplicaAt[k + 1];
+
+		double delta = (Ladder[k] - Ladder[k + 1]) * (Sums[2 * a + 1] - Sums[2 * b + 1]);
+
+		uint32_t ctr[4] = {Attempts, (uint32_t)k, 0, PT_SWAPS};
+		uint32_t rands[4];
+		philox4x32(ctr, Key, rands);
+
+		nTried[k]++;
+
+		if (rands[0] <= acceptThreshold(exp(delta)))
+		{
+			ReplicaAt[k] = b;
+			ReplicaAt[k + 1] = a;
+			BetaOf[a] = k + 1;
+			BetaOf[b] = k;
+			nAccepted[k]++;
+		}
+	}
+
+	Attempts++;
+
+	Lattice->setBeta(Ladder[BetaOf[Host->Replica]]);
+}
+
+
+/*
+ * store X and the energy per site of the replica at
+ * every beta index
+ */
+void Tempering::measure(void)
+{
+	gatherSums();
+
+	if (Host->Rank != ROOT || Host->Replica != 0)
+		return;
+
+	for (int k = 0; k < nBetas; k++)
+	{
+		int r = ReplicaAt[k];
+
+		SeriesXt[k].append(Lattice->computeX(Sums[2 * r], nSites));
+		SeriesEt[k].append(Sums[2 * r + 1] / nSites);
+	}
+}
+
+};
+
+
+/*================ End of File ================*/
@@ -0,0 +1,73 @@
+/*=====================================================
+ * Tempering.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the class Tempering that
+ * runs the replicas of a lattice system at a ladder
+ * of betas and swaps the betas of the replicas
+ *=====================================================*/
+
+
+#ifndef TEMPERING_H_
+#define TEMPERING_H_
+
+
+#include <fstream>
+#include <sstream>
+#include <stdint.h>
+
+#include "BaseLattice.h"
+#include "Acceptance.h"
+#include "Philox.h"
+
+
+// Philox stream (counter word 3) of the swaps
+#define PT_SWAPS 6
+
+
+namespace wenchong
+{
+
+class Tempering
+{
+public:
+	Tempering(Machine* host, BaseLattice* lattice);
+	~Tempering();
+
+	void run(void);
+
+private:
+	Machine* Host;         // host processor
+	BaseLattice* Lattice;  // the replica of this process
+	Communicator* Comms;   // sums over grids and replicas
+
+	int nBetas;            // # of betas, one per replica
+	double* Ladder;        // the betas
+	int* BetaOf;           // beta index of a replica
+	int* ReplicaAt;        // replica at a beta index
+	double* Sums;          // spin and bond sums per replica
+	double nSites;         // # of sites of the global lattice
+
+	int Interval;          // # of sweeps between swaps
+	unsigned int nSweepsDone; // # of sweeps of this run
+	unsigned int Attempts; // # of swap rounds, Philox counter
+	uint32_t Key[2];       // Philox key: global seed, stream
+	long* nTried;          // swaps tried per pair of betas
+	long* nAccepted;       // swaps accepted per pair of betas
+
+	TimeSeries* SeriesXt;  // xt.k.bin per beta index k
+	TimeSeries* SeriesEt;  // et.k.bin per beta index k
+
+	void sweep(int numSweeps);
+	void gatherSums(void);
+	void swapBetas(void);
+	void measure(void);
+};
+
+};
+
+
+#endif
@@ -0,0 +1,206 @@
+/*=====================================================
+ * TimeSeries.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class
+ * TimeSeries, the values of the measures are kept
+ * in a buffer and written SERIES_BUFFER at a time,
+ * instead of a flushed line per measure
+ *=====================================================*/
+
+
+#include <stdexcept>
+
+#include "TimeSeries.h"
+
+
+namespace wenchong
+{
+
+/*
+ * a series that is not open yet
+ */
+TimeSeries::TimeSeries()
+{
+	File = NULL;
+}
+
+
+/*
+ * destructor: write the buffer and close the file
+ * if not closed yet, without throwing
+ */
+TimeSeries::~TimeSeries()
+{
+	if (File == NULL)
+		return;
+
+	fwrite(Buffer.data(), sizeof(double), Buffer.size(), File);
+	fclose(File);
+}
+
+
+/*
+ * the header of a series of the run
+ */
+SeriesHeader TimeSeries::makeHeader(const char* name, const char* algo,
+									int nxGlobal, int nyGlobal, int nColumns,
+									int nSweeps, unsigned int seed, double beta)
+{
+	SeriesHeader header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.Magic, "ISINGTS1", 8);
+	strncpy(header.Name, name, sizeof(header.Name) - 1);
+	strncpy(header.Algo, algo, sizeof(header.Algo) - 1);
+	header.nxGlobal = nxGlobal;
+	header.nyGlobal = nyGlobal;
+	header.nColumns = nColumns;
+	header.nSweeps = nSweeps;
+	header.Seed = seed;
+	header.Beta = beta;
+	header.One = 1.0;
+
+	return header;
+}
+
+
+/*
+ * create filename and write the header, or with
+ * keepRows > 0 go on after the first keepRows rows
+ * of the series filename of a resumed run
+ */
+void TimeSeries::open(const std::string& filename, const SeriesHeader& header,
+					  long keepRows)
+{
+	close();
+
+	Filename = filename;
+	Buffer.reserve(SERIES_BUFFER);
+
+	if (keepRows > 0)
+	{
+		long length = SERIES_HEADER + keepRows * header.nColumns * (long)sizeof(double);
+		File = fopen(filename.c_str(), "r+b");
+
+		if (File == NULL || fseek(File, 0, SEEK_END) != 0 || ftell(File) < length ||
+			ftruncate(fileno(File), length) != 0 || fseek(File, length, SEEK_SET) != 0)
+			throw std::invalid_argument("TimeSeries::(): " + filename
+										+ " does not hold the rows resumed");
+		return;
+	}
+
+	File = fopen(filename.c_str(), "wb");
+
+	if (File == NULL)
+		throw std::invalid_argument("TimeSeries::(): Error opening file " + filename);
+
+	char block[SERIES_HEADER];
+	memset(block, 0, sizeof(block));
+	memcpy(block, &header, sizeof(header));
+
+	if (fwrite(block, 1, sizeof(block), File) != sizeof(block))
+		throw std::runtime_error("TimeSeries::(): Error writing file " + filename);
+}
+
+
+/*
+ * append a value of the current row
+ */
+void TimeSeries::append(double value)
+{
+	Buffer.push_back(value);
+
+	if (Buffer.size() == SERIES_BUFFER)
+		flush();
+}
+
+
+/*
+ * write the buffered values to the file
+ */
+void TimeSeries::flush(void)
+{
+	if (File == NULL || Buffer.empty())
+		return;
+
+	if (fwrite(Buffer.data(), sizeof(double), Buffer.size(), File) != Buffer.size() ||
+		fflush(File) != 0)
+		throw std::runtime_error("TimeSeries::(): Error writing file " + Filename);
+
+	Buffer.clear();
+}
+
+
+/*
+ * map filename and check its header, a series of
+ * the other byte order is rejected
+ */
+SeriesMap::SeriesMap(const std::string& filename)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	struct stat status;
+
+	if (fd < 0 || fstat(fd, &status) != 0)
+		throw std::invalid_argument("SeriesMap::(): Error opening file " + filename);
+
+	Length = (size_t)status.st_size;
+	if (Length < SERIES_HEADER)
+	{
+		::close(fd);
+		throw std::invalid_argument("SeriesMap::(): " + filename + " has no header");
+	}
+
+	Base = mmap(NULL, Length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (Base == MAP_FAILED)
+		throw std::runtime_error("SeriesMap::(): Error mapping file " + filename);
+
+	// the values are read once, front to back
+	madvise(Base, Length, MADV_SEQUENTIAL);
+
+	memcpy(&Header, Base, sizeof(Header));
+
+	if (strncmp(Header.Magic, "ISINGTS1", 8) != 0 || Header.One != 1.0 ||
+		Header.nColumns < 1)
+	{
+		munmap(Base, Length);
+		throw std::invalid_argument("SeriesMap::(): " + filename
+									+ " is not a time series of this byte order");
+	}
+
+	Values = (const double*)((const char*)Base + SERIES_HEADER);
+	nRows = (long)((Length - SERIES_HEADER) / sizeof(double) / Header.nColumns);
+}
+
+
+/*
+ * destructor: unmap the file
+ */
+SeriesMap::~SeriesMap()
+{
+	munmap(Base, Length);
+}
+
+
+/*
+ * write the buffer and close the file, if open
+ */
+void TimeSeries::close(void)
+{
+	if (File == NULL)
+		return;
+
+	flush();
+	fclose(File);
+	File = NULL;
+}
+
+};
+
+
+/*================ End of File ================*/
@@ -0,0 +1,105 @@
+/*=====================================================
+ * TimeSeries.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the binary time-series
+ * format of the measures and the class TimeSeries
+ * that writes it through a large buffer
+ *=====================================================*/
+
+
+#ifndef TIMESERIES_H_
+#define TIMESERIES_H_
+
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// bytes of the header at the start of a series file
+#define SERIES_HEADER 128
+
+// # of values buffered before a write
+#define SERIES_BUFFER 65536
+
+
+namespace wenchong
+{
+
+/*
+ * a series file is the header, padded to SERIES_HEADER
+ * bytes, and the rows of nColumns doubles in the byte
+ * order of One, the rows follow from the file size
+ */
+struct SeriesHeader
+{
+	char Magic[8];      // "ISINGTS1"
+	char Name[16];      // "xt", "et", "mt", ...
+	char Algo[16];      // algo=... of the run
+	int32_t nxGlobal;   // # of points on global x-axis
+	int32_t nyGlobal;   // # of points on global y-axis
+	int32_t nColumns;   // # of values of a measure
+	int32_t nSweeps;    // # of sweeps between two measures
+	uint32_t Seed;      // global seed of the run
+	uint32_t Padding;
+	double Beta;        // Beta = J/K(B)T
+	double One;         // 1.0, to check the byte order
+};
+
+
+class TimeSeries
+{
+public:
+	TimeSeries();
+	~TimeSeries();
+
+	void open(const std::string& filename, const SeriesHeader& header,
+			  long keepRows);
+	void append(double value);
+	void flush(void);
+	void close(void);
+
+	static SeriesHeader makeHeader(const char* name, const char* algo,
+								   int nxGlobal, int nyGlobal, int nColumns,
+								   int nSweeps, unsigned int seed, double beta);
+
+private:
+	FILE* File;                 // the open series, or NULL
+	std::string Filename;       // for the error messages
+	std::vector<double> Buffer; // values not written yet
+};
+
+
+/*
+ * a series file mapped into memory read-only, the
+ * values are read in place without a copy
+ */
+class SeriesMap
+{
+public:
+	SeriesMap(const std::string& filename);
+	~SeriesMap();
+
+	SeriesHeader Header;  // the header of the series
+	const double* Values; // the first value of the first row
+	long nRows;           // # of complete rows
+
+private:
+	void* Base;           // the mapping of the whole file
+	size_t Length;        // # of bytes mapped
+};
+
+};
+
+
+#endif
@@ -0,0 +1,313 @@
+/*=====================================================
+ * Wolff.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This definition file implements the class Wolff,
+ * a step grows one cluster of equal spins from a
+ * random site and flips it, the cluster is grown
+ * level by level so that the threads share a level
+ *=====================================================*/
+
+
+#include "Wolff.h"
+
+
+namespace wenchong
+{
+
+/*
+ * construct the 2D lattice system, a cluster spans
+ * the whole lattice, so it runs on one process
+ */
+Wolff::Wolff(Machine* host, int init, double beta, unsigned int seed)
+	 : BaseLattice(host, init, beta, seed)
+{
+	if (host->nProc != 1)
+	{
+		std::cout << "algo=wolff runs on one process\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	setBeta(beta);
+
+	Key[0] = host->Seed;
+	Key[1] = host->Replica;
+	Step = 0;
+	nThreads = host->nThreads;
+
+	// allocated once, a cluster has at most Size sites,
+	// the bitmap is cleared by the sites of the cluster
+	Cluster = new int[Size];
+	nCluster = 0;
+
+	int nWords = (Size + 63) / 64;
+	Visited = new uint64_t[nWords];
+	for (int w = 0; w < nWords; w++)
+		Visited[w] = 0;
+}
+
+
+/*
+ * destructor: release resources
+ */
+Wolff::~Wolff()
+{
+	delete [] Cluster;
+	delete [] Visited;
+}
+
+
+/*
+ * set Beta and pre-compute the bond probability of it
+ */
+void Wolff::setBeta(double beta)
+{
+	Beta = beta;
+
+	// a neighbour of equal spin joins the cluster
+	// with probability 1 - exp(-2 * Beta)
+	Factor = -2 * Beta;
+	Threshold = acceptThreshold(1 - exp(Factor));
+}
+
+
+/*
+ * a step per sweep: grow a cluster from a random
+ * site and flip it
+ */
+void Wolff::update(int numSweeps)
+{
+	for (int i = 0; i < numSweeps; i++)
+	{
+		uint32_t ctr[4] = {Step, 0, 0, WOLFF_SEEDS};
+		uint32_t rands[4];
+		philox4x32(ctr, Key, rands);
+
+		growCluster((int)(((uint64_t)rands[0] * (uint64_t)Size) >> 32));
+		flipCluster();
+
+		Step++;
+	}
+}
+
+
+/*
+ * spin of site row * nCol + col
+ */
+int& Wolff::spin(int site)
+{
+	int row = site / nCol;
+	int col = site % nCol;
+
+	return Spins->Sites[(row + col) & 1][row * Spins->nyStride + (col >> 1)];
+}
+
+
+/*
+ * the neighbour of a site in direction dir,
+ * wrapped around the periodic lattice
+ */
+int Wolff::neighbour(int site, int dir)
+{
+	int row = site / nCol;
+	int col = site % nCol;
+
+	switch (dir)
+	{
+		case NORTH: col = (col + 1 == nCol) ? 0 : col + 1; break;
+		case SOUTH: col = (col == 0) ? nCol - 1 : col - 1; break;
+		case EAST:  row = (row + 1 == nRow) ? 0 : row + 1; break;
+		default:    row = (row == 0) ? nRow - 1 : row - 1; break;
+	}
+
+	return row * nCol + col;
+}
+
+
+/*
+ * whether the bond of a site in direction dir is
+ * active, given equal spins, the number of a bond is
+ * drawn by its left or upper site and Step, so the
+ * cluster does not depend on the order of growth
+ */
+bool Wolff::isBonded(int site, int dir)
+{
+	int owner = site;
+	int word = 0;
+
+	if (dir == SOUTH || dir == WEST)
+		owner = neighbour(site, dir);
+
+	if (dir == EAST || dir == WEST)
+		word = 1;
+
+	uint32_t ctr[4] = {(uint32_t)owner, Step, 0, WOLFF_BONDS};
+	uint32_t rands[4];
+	philox4x32(ctr, Key, rands);
+
+	return rands[word] <= Threshold;
+}
+
+
+/*
+ * mark a site as in the cluster, true if this call
+ * has marked it, the threads of a level may race
+ * for a site
+ */
+bool Wolff::visit(int site)
+{
+	uint64_t bit = 1ULL << (site % 64);
+	uint64_t old = __atomic_fetch_or(Visited + site / 64, bit, __ATOMIC_RELAXED);
+
+	return (old & bit) == 0;
+}
+
+
+/*
+ * grow the cluster of seedSite into Cluster, level by
+ * level: the sites of a level test their bonds to the
+ * neighbours of equal spin and append the new ones as
+ * the next level, in place, so Cluster is the stack
+ * of the growth and the list of the cluster at once
+ */
+void Wolff::growCluster(int seedSite)
+{
+	int value = spin(seedSite);
+
+	visit(seedSite);
+	Cluster[0] = seedSite;
+
+	int begin = 0;
+	int end = 1;
+
+	while (begin < end)
+	{
+		int next = end;
+
+		#pragma omp parallel for schedule(static) num_threads(nThreads) \
+			if (end - begin >= WOLFF_SERIAL)
+		for (int i = begin; i < end; i++)
+		{
+			int site = Cluster[i];
+
+			for (int dir = 0; dir < 4; dir++)
+			{
+				int other = neighbour(site, dir);
+
+				if (spin(other) != value || !isBonded(site, dir))
+					continue;
+
+				if (visit(other))
+					Cluster[__atomic_fetch_add(&next, 1, __ATOMIC_RELAXED)] = other;
+			}
+		}
+
+		begin = end;
+		end = next;
+	}
+
+	nCluster = end;
+}
+
+
+/*
+ * flip the cluster and update the running totals,
+ * the bonds to the neighbours outside the cluster
+ * change sign, then clear the bits of the cluster
+ */
+void Wolff::flipCluster(void)
+{
+	int value = spin(Cluster[0]);
+	long energy = 0;
+
+	#pragma omp parallel for schedule(static) num_threads(nThreads) \
+		reduction(+:energy) if (nCluster >= WOLFF_SERIAL)
+	for (int i = 0; i < nCluster; i++)
+	{
+		int site = Cluster[i];
+
+		for (int dir = 0; dir < 4; dir++)
+		{
+			int other = neighbour(site, dir);
+
+			if (((Visited[other / 64] >> (other % 64)) & 1) == 0)
+				energy += 2 * value * spin(other);
+		}
+	}
+
+	for (int i = 0; i < nCluster; i++)
+	{
+		int site = Cluster[i];
+
+		spin(site) = -value;
+		Visited[site / 64] = 0;
+	}
+
+	Magnet -= 2 * (long)value * nCluster;
+	Energy += energy;
+}
+
+
+/*
+ * the size of the last cluster, for the improved
+ * estimator of X
+ */
+double Wolff::spinMeasure(void)
+{
+	return (double)nCluster;
+}
+
+
+/*
+ * improved estimator: <m^2> = <|C|> / N, so a
+ * measure is the size of a cluster over the sites
+ */
+double Wolff::computeX(double spinSum, double nGlobalSites)
+{
+	return spinSum / nGlobalSites;
+}
+
+
+/*
+ * DO NOT use this function,
+ * the cluster is updated by steps in update
+ */
+void Wolff::updateLattice(int /*evenOddFlag*/)
+{
+}
+
+
+/*
+ * DO NOT use this function,
+ * the bonds are tested in growCluster
+ */
+bool Wolff::isAccept(int /*row*/, int /*col*/)
+{
+	return false;
+}
+
+
+/*
+ * the Philox counter, # of clusters grown
+ */
+unsigned int Wolff::getCounter(void)
+{
+	return Step;
+}
+
+
+/*
+ * restore the Philox counter of a checkpoint
+ */
+void Wolff::setCounter(unsigned int counter)
+{
+	Step = counter;
+}
+
+};
+
+
+/*================ End of File ================*/
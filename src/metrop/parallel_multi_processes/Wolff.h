@@ -0,0 +1,72 @@
+/*=====================================================
+ * Wolff.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This header file declares the class Wolff that
+ * implements the single-cluster Wolff algorithm
+ *=====================================================*/
+
+
+#ifndef WOLFF_H_
+#define WOLFF_H_
+
+
+#include <stdint.h>
+
+#include "BaseLattice.h"
+#include "Acceptance.h"
+#include "Philox.h"
+
+
+// Philox streams (counter word 3) of the bonds and the
+// seed sites, next to those of SwendsenWang
+#define WOLFF_BONDS 4
+#define WOLFF_SEEDS 5
+
+// frontiers smaller than this are grown by one thread
+#define WOLFF_SERIAL 256
+
+
+namespace wenchong
+{
+
+class Wolff : public BaseLattice
+{
+public:
+	Wolff(Machine* host, int init, double beta, unsigned int seed);
+	~Wolff();
+
+	virtual void update(int numSweeps);
+	virtual void setBeta(double beta);
+
+private:
+	uint32_t Threshold;   // 1 - exp(-2 * Beta) as 32-bit threshold
+	uint32_t Key[2];      // Philox key: global seed, stream
+	unsigned int Step;    // # of clusters grown, Philox counter
+	int nThreads;         // # of threads growing a frontier
+
+	int* Cluster;         // sites of the cluster, level by level
+	int nCluster;         // # of sites of the last cluster
+	uint64_t* Visited;    // bitmap of the sites in the cluster
+
+	int& spin(int site);
+	int neighbour(int site, int dir);
+	bool isBonded(int site, int dir);
+	bool visit(int site);
+	void growCluster(int seedSite);
+	void flipCluster(void);
+	virtual void updateLattice(int evenOddFlag);
+	virtual bool isAccept(int row, int col);
+	virtual double spinMeasure(void);
+	virtual double computeX(double spinSum, double nGlobalSites);
+	virtual unsigned int getCounter(void);
+	virtual void setCounter(unsigned int counter);
+};
+
+};
+
+
+#endif
@@ -18,6 +18,12 @@
 #include "mpi.h"
 
 #include "Metrop.h"
+#include "HeatBath.h"
+#include "SwendsenWang.h"
+#include "Wolff.h"
+#include "Tempering.h"
+#include "MultiSpin.h"
+#include "MultiReplica.h"
 #include "Machine.h"
 
 
@@ -27,21 +33,30 @@ using namespace std;
 
 int main(int argc, char* argv[])
 {
-	MPI_Init(&argc, &argv);
+	// only the master thread calls MPI, between the
+	// parallel regions of the sweeps
+	int provided;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+	if (provided < MPI_THREAD_FUNNELED)
+	{
+		cout << "MPI_THREAD_FUNNELED is not supported\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
 	
 	Machine* host = new Machine(argc, argv);
 
 	
 	//============ seeding the RNG in each process ============//
 	unsigned int seed = 0;              // the seed to generate u~(0, 1)
-	unsigned int seedOfSeed = 25938026; // the seed to generate random seed above
+	unsigned int seedOfSeed = host->Seed; // the seed to generate random seed above
 	mt19937 gen(seedOfSeed);
 	uniform_int_distribution<int> randSeed(1000000, 99999999);
 
 	// each process gets a fixed random seed,
 	// then the seed will be passed into the Metrop class
 	// to construct RNG and RN distribution type
-	for (int i = 0; i < host->Rank + 1; i++)
+	for (int i = 0; i < host->Replica * host->nProc + host->Rank + 1; i++)
 	{
 		seed = randSeed(gen);
 	}
@@ -51,20 +66,82 @@ int main(int argc, char* argv[])
 	int init = 1;       // initial spin value
 	double beta = log(1 + sqrt(2)) / 2; // beta = J/K(B)T
 	
-	// class Metrop encapsulates the Metropolis lattice system
-	Metrop c = Metrop(host, init, beta, seed);
+	// algo=metrop (default), algo=multispin,
+	// algo=multireplica, algo=heatbath,
+	// algo=swendsenwang or algo=wolff selects the
+	// lattice system and its update algorithm
+	const char* algo = host->getOption("algo", "metrop");
+	BaseLattice* c = NULL;
+
+	if (strcmp(algo, "metrop") == 0)
+		c = new Metrop(host, init, beta, seed);
+	else if (strcmp(algo, "multispin") == 0)
+		c = new MultiSpin(host, init, beta, seed);
+	else if (strcmp(algo, "multireplica") == 0)
+		c = new MultiReplica(host, init, beta, seed);
+	else if (strcmp(algo, "heatbath") == 0)
+		c = new HeatBath(host, init, beta, seed);
+	else if (strcmp(algo, "swendsenwang") == 0)
+		c = new SwendsenWang(host, init, beta, seed);
+	else if (strcmp(algo, "wolff") == 0)
+		c = new Wolff(host, init, beta, seed);
+	else
+	{
+		cout << "Unknown algorithm: " << algo << "\n";
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
 	
 	
 	//===== start counting programme execution wall time =====//
 	double elapsedTime = MPI_Wtime();
 
 	
-	//============ thermalization ============//
-	c.update(host->nThrow);
-	
-	
-	//============ compute X(t) ============//
-	c.computeXt();
+	//============ parallel tempering ============//
+	// betas=b0,b1,... runs a replica per beta,
+	// thermalized and measured by Tempering
+	Tempering* pt = NULL;
+
+	if (host->nReplicas > 1)
+	{
+		pt = new Tempering(host, c);
+		pt->run();
+	}
+	//============ re-analysis ============//
+	// retrieve=xt.bin maps a series of a former run,
+	// first=I, count=N and stride=S select from it
+	else if (*host->getOption("retrieve", "") != '\0')
+	{
+		c->retrieveXt(host->getOption("retrieve", ""),
+					  atol(host->getOption("first", "0")),
+					  atol(host->getOption("count", "0")),
+					  atol(host->getOption("stride", "1")));
+	}
+	//============ temperature scan ============//
+	// scan=b0,b1,... measures the betas in turn, a beta
+	// is re-thermalized from the spins of the one before,
+	// and its output goes to xt.k.bin, tau.k.dat, ...
+	else if (!host->Scan.empty())
+	{
+		for (int k = 0; k < (int)host->Scan.size(); k++)
+		{
+			c->setBeta(host->Scan[k]);
+			c->startPoint(k);
+
+			c->update((k == 0) ? host->nThrow : host->nRethrow);
+			c->computeXt();
+			c->computeRhoTau();
+		}
+	}
+	else
+	{
+		//============ thermalization ============//
+		// from the last checkpoint with checkpoint=N
+		c->thermalize(host->nThrow);
+
+
+		//============ compute X(t) ============//
+		c->computeXt();
+	}
 	
 
 	//===== compute programme execution wall time =====//
@@ -73,15 +150,13 @@ int main(int argc, char* argv[])
 			 << ": Elapsed wall time: " << elapsedTime << " seconds\n\n";
 	
 
-	//===== get X(t) from file to compute Rho(t) and Tau(t) =====//
-	//char* filenameXt = (char*)"xt.dat";
-	//c.retrieveXt(filenameXt);
-	
-
 	//===== compute autocorrelation Rho(t) and Tau(t) =====//
-	c.computeRhoTau();	
+	if (pt == NULL && host->Scan.empty() && !c->isStopped())
+		c->computeRhoTau();
 
 
+	delete pt;
+	delete c;
 	delete host;
 	
 	MPI_Finalize();
@@ -39,7 +39,9 @@ set title "Susceptibility with J/K(B)T = log(1 + sqrt(2)) / 2"
 
 set output "xt.png"
 
-plot "xt.dat" u (hist($1,width)):(1.0) smooth freq w boxes lc rgb"green" notitle
+# main writes the binary series xt.bin, read it
+# through series2text, built by 'make'
+plot "< ./series2text xt.bin" u (hist($1,width)):(1.0) smooth freq w boxes lc rgb"green" notitle
 
 unset output
 
@@ -0,0 +1,92 @@
+/*=====================================================
+ * series2text.cpp
+ *
+ * @Author: Wenchong Chen
+ *
+ * Code for MSc Project
+ *
+ * This file is for exporting a binary time series,
+ * e.g. xt.bin, to text, a line per measure as the
+ * former xt.dat:
+ *
+ *    $./series2text [-h] xt.bin > xt.dat
+ *
+ * with -h the header is printed first as # lines
+ *=====================================================*/
+
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+
+#include "TimeSeries.h"
+
+
+using namespace wenchong;
+using namespace std;
+
+
+int main(int argc, char* argv[])
+{
+	bool printHeader = (argc == 3 && strcmp(argv[1], "-h") == 0);
+
+	if (argc != 2 && !printHeader)
+	{
+		cerr << "Usage: ./series2text [-h] series.bin\n";
+		return 1;
+	}
+
+	const char* filename = argv[argc - 1];
+	ifstream ifs(filename, ifstream::in | ifstream::binary);
+
+	if (!ifs.is_open())
+	{
+		cerr << "Error opening file " << filename << "\n";
+		return 1;
+	}
+
+	char block[SERIES_HEADER];
+	SeriesHeader header;
+
+	ifs.read(block, SERIES_HEADER);
+	memcpy(&header, block, sizeof(header));
+
+	if (!ifs || strncmp(header.Magic, "ISINGTS1", 8) != 0 ||
+		header.One != 1.0 || header.nColumns < 1)
+	{
+		cerr << filename << " is not a time series of this byte order\n";
+		return 1;
+	}
+
+	if (printHeader)
+	{
+		cout << "# name=" << string(header.Name, strnlen(header.Name, sizeof(header.Name)))
+			 << " algo=" << string(header.Algo, strnlen(header.Algo, sizeof(header.Algo)))
+			 << " L=" << header.nxGlobal << "x" << header.nyGlobal
+			 << " beta=" << header.Beta
+			 << " seed=" << header.Seed
+			 << " sweeps=" << header.nSweeps
+			 << " columns=" << header.nColumns << "\n";
+	}
+
+	// a row of nColumns values per line, read a
+	// buffer of rows at a time
+	int nColumns = header.nColumns;
+	int nRows = (SERIES_BUFFER + nColumns - 1) / nColumns;
+	vector<double> values((size_t)nRows * nColumns);
+
+	while (ifs)
+	{
+		ifs.read((char*)values.data(), values.size() * sizeof(double));
+		size_t count = ifs.gcount() / sizeof(double) / nColumns * nColumns;
+
+		for (size_t j = 0; j < count; j++)
+			cout << values[j] << (((j + 1) % nColumns == 0) ? "\n" : " ");
+	}
+
+	return 0;
+}
+
+
+/* =============== End of Programme =============== */
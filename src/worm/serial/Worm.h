@@ -18,6 +18,7 @@
 #include <omp.h>
 
 #include "BaseLattice.h"
+#include "Acceptance.h"
 
 
 #define  X  0  // index for positive x direction
@@ -43,6 +44,7 @@ private:
 	int Tail[2];   // Tail site that crawls
 
 	double TanhBeta; // tanh(beta) = e^(-u)
+	uint32_t TanhThreshold; // tanh(beta) as 32-bit threshold
 
 	// to store links between sites
 	bool* Links;
@@ -100,8 +100,8 @@ void BaseLattice::computeRhoTau(void)
 			throw std::invalid_argument("BaseLattice::(): Error opening files!");
 	
 		// write the first values at t=0 to files
-		ofsRho << "0 " << Rho << std::endl;
-		ofsTau << "0 " << Tau << std::endl;
+		ofsRho << "0 " << Rho << "\n";
+		ofsTau << "0 " << Tau << "\n";
 	
 		// iterate through t from 1 to DELTA_TIME
 		for (int t = 1; t <= DELTA_TIME; t++)
@@ -124,8 +124,8 @@ void BaseLattice::computeRhoTau(void)
 			Tau += Rho;
 		
 			// write data to files
-			ofsRho << t << " " << Rho << std::endl;
-			ofsTau << t << " " << Tau << std::endl;
+			ofsRho << t << " " << Rho << "\n";
+			ofsTau << t << " " << Tau << "\n";
 		}
 	
 		ofsRho.close();
@@ -34,6 +34,7 @@ Worm::Worm(Machine* host, int init, double beta, unsigned int seed)
 
 	nKick = 0;
 	TanhBeta = tanh(Beta);
+	TanhThreshold = acceptThreshold(TanhBeta);
 	Factor = pow(nRow, 1.75) / (double)Size; // L^(7/4)
 
 	for (int i = 0; i < 2; i++)
@@ -226,13 +227,13 @@ bool Worm::isAccept(int linkID)
 	/*
 	 * condition 2: kl = 0,
 	 * tanh(beta)^(1-2kl) = 0.41421356 < 1,
-	 * - if u ~ U(0, 1) <= tanh(beta)^(1-2kl),
+	 * - if r ~ U[0, 2^32) <= tanh(beta)^(1-2kl)
+	 *   as a 32-bit threshold,
 	 *   --> accept
 	 * - otherwise,
 	 *   --> don't accept
 	 */
-	double u = UniformDist(Generator);
-	if (u <= TanhBeta)
+	if (Generator() <= TanhThreshold)
 		return true;
 
 	return false;
@@ -283,7 +284,7 @@ void Worm::computeXt(void)
 			Var += average * average;
 			
 			// store average magnetization in file
-			ofsXt << average << std::endl;
+			ofsXt << average << "\n";
 		}
 	}
 	
@@ -18,6 +18,7 @@
 #include <omp.h>
 
 #include "BaseLattice.h"
+#include "Acceptance.h"
 
 
 #define  X  0  // index for positive x direction
@@ -48,14 +49,15 @@ private:
 	int Neib[2][2];
 
 	double TanhBeta; // tanh(beta) = e^(-u)
+	uint32_t TanhThreshold; // tanh(beta) as 32-bit threshold
 
 	// to store links between sites
 	bool* Links;
 
-	omp_lock_t Lock;
+	omp_lock_t* Locks; // a lock for each link
 
 	void randKick(void);
-	void randNeighbour(int* row, int* col);
+	void randNeighbour(const int* curSite, int* newSite);
 	bool isLinkOn(const int* curSite, const int* newSite);
 	bool isAdjacent(const int* curSite, const int* newSite);
 	void turnOnLink(const int* curSite, const int* newSite);
@@ -63,7 +65,7 @@ private:
 
 	virtual void updateLattice(int evenOddFlag);
 	virtual bool isAccept(int row, int col);
-	void checkAccept(int* curSite, int* neibSite);
+	bool isAccept(int linkID);
 };
 
 };